@@ -0,0 +1,72 @@
+/*
+  Kilosim
+
+  Helpers for writing and reading binary checkpoints of a simulation
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_CHECKPOINT_H
+#define __KILOSIM_CHECKPOINT_H
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace Kilosim
+{
+/*!
+ * Write a plain value (number, bool, or struct/array of them) to a
+ * checkpoint exactly as it is in memory, so it is restored bit-for-bit.
+ *
+ * Use this (and checkpoint_read) to save your own controller state in
+ * `Kilobot::save_state` and `Kilobot::load_state`.
+ *
+ * @param out Stream the checkpoint is written to
+ * @param val Value to write
+ */
+template <class T>
+void checkpoint_write(std::ostream &out, const T &val)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only plain values can be written directly to a checkpoint");
+  out.write((const char *)&val, sizeof(T));
+}
+
+/*!
+ * Read a plain value written by checkpoint_write. Throws a
+ * `std::runtime_error` if the checkpoint ends early.
+ *
+ * @param in Stream the checkpoint is read from
+ * @param val Value to read into
+ */
+template <class T>
+void checkpoint_read(std::istream &in, T &val)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only plain values can be read directly from a checkpoint");
+  if (!in.read((char *)&val, sizeof(T)))
+    throw std::runtime_error("Checkpoint ended unexpectedly");
+}
+
+//! Write a string to a checkpoint (prefixed by its length)
+inline void checkpoint_write(std::ostream &out, const std::string &str)
+{
+  checkpoint_write(out, (uint64_t)str.size());
+  out.write(str.data(), str.size());
+}
+
+//! Read a string written by checkpoint_write
+inline void checkpoint_read(std::istream &in, std::string &str)
+{
+  uint64_t size;
+  checkpoint_read(in, size);
+  str.resize(size);
+  if (size > 0 && !in.read(&str[0], size))
+    throw std::runtime_error("Checkpoint ended unexpectedly");
+}
+} // namespace Kilosim
+
+#endif
@@ -28,13 +28,16 @@ private:
   double diameter; //Collision diameter
   int bwidth;      //Width in bins
   int bheight;     //Height in bins
+  double x0;       //Left edge of the area covered (if not the whole arena)
 
 public:
   CollisionBoxes() = default;
 
-  CollisionBoxes(const double width0, const double height0, const double diameter0)
+  CollisionBoxes(const double width0, const double height0, const double diameter0,
+                 const double x00 = 0)
   {
     diameter = diameter0;
+    x0 = x00;
     bwidth = std::ceil(width0 / diameter);
     bheight = std::ceil(height0 / diameter);
 
@@ -51,7 +54,7 @@ public:
 
     for (unsigned int a = 0; a < agents.size(); a++)
     {
-      const int binx = agents[a].x / diameter;
+      const int binx = (agents[a].x - x0) / diameter;
       const int biny = agents[a].y / diameter;
       const int idx0 = PSIZE * (biny * bwidth + binx);
       int idx = idx0;
@@ -67,7 +70,7 @@ public:
   template <class F>
   void considerNeighbours(const double x, const double y, F func) const
   {
-    const int cbinx = x / diameter;
+    const int cbinx = (x - x0) / diameter;
     const int cbiny = y / diameter;
 
     for (unsigned int nbi = 0; nbi <= 8; nbi++)
@@ -0,0 +1,181 @@
+/*
+  Kilosim
+
+  Typed binding of config values to variables, checked once at load time
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_CONFIGBINDER_H
+#define __KILOSIM_CONFIGBINDER_H
+
+#include <kilosim/ConfigParser.h>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Kilosim
+{
+/*!
+ * A ConfigBinder reads config values into typed variables (e.g., the fields
+ * of a plain parameter struct) once, so code that uses them doesn't look up
+ * and convert JSON values every time.
+ *
+ * Bind each variable to a key with #bind, then call #resolve to read them
+ * all. Every missing key and wrong type is reported together (rather than
+ * stopping at the first one), and then the program exits:
+ *
+ * ```
+ * struct Params
+ * {
+ *   int num_robots;
+ *   double trial_duration;
+ *   std::string log_filename;
+ *   double comm_range;
+ * } params;
+ *
+ * Kilosim::ConfigBinder binder(config);
+ * binder.bind("num_robots", params.num_robots)
+ *     .bind("trial_duration", params.trial_duration)
+ *     .bind("log_filename", params.log_filename)
+ *     .bind("comm_range", params.comm_range, 60.0);
+ * binder.resolve();
+ * ```
+ *
+ * Bound variables must outlive the call to #resolve. Any type that
+ * nlohmann/json can convert to works (numbers, bools, strings, vectors,
+ * etc.). Integer variables only accept integer values that fit in their
+ * type (so unsigned variables only accept non-negative ones).
+ */
+class ConfigBinder
+{
+private:
+  //! Reads a value into its variable. Returns an error message (empty if
+  //! successful)
+  typedef std::function<std::string(const json &)> Reader;
+
+  //! A variable bound to a config key
+  struct Binding
+  {
+    //! Key of the value in the config
+    std::string name;
+    //! Reads the value into the variable
+    Reader read;
+    //! Sets the variable to its default (null if the key is required)
+    std::function<void()> set_default;
+  };
+
+  //! Config the values come from
+  const ConfigParser &m_config;
+  //! Variables bound so far, in order
+  std::vector<Binding> m_bindings;
+
+public:
+  /*!
+   * Create a binder for values in a config
+   * @param config Config to read values from (must outlive the binder)
+   */
+  ConfigBinder(const ConfigParser &config);
+
+  /*!
+   * Bind a variable to a required config key
+   * @param name Key of the value in the config
+   * @param dest Variable to set to the value when #resolve is called
+   * @return This binder (to chain calls)
+   */
+  template <typename T>
+  ConfigBinder &bind(const std::string name, T &dest)
+  {
+    m_bindings.push_back({name, make_reader(dest), nullptr});
+    return *this;
+  }
+
+  /*!
+   * Bind a variable to an optional config key
+   * @param name Key of the value in the config
+   * @param dest Variable to set to the value when #resolve is called
+   * @param default_val Value to use if the config doesn't contain the key
+   * @return This binder (to chain calls)
+   */
+  template <typename T>
+  ConfigBinder &bind(const std::string name, T &dest, const T default_val)
+  {
+    T *ptr = &dest;
+    m_bindings.push_back({name, make_reader(dest),
+                          [ptr, default_val]() { *ptr = default_val; }});
+    return *this;
+  }
+
+  /*!
+   * Read every bound value into its variable. If any are missing (without a
+   * default) or have the wrong type, all of the errors are printed and the
+   * program exits.
+   */
+  void resolve() const;
+
+private:
+  //! Create a reader that converts a value to the variable's type
+  template <typename T>
+  static Reader make_reader(T &dest)
+  {
+    T *ptr = &dest;
+    return [ptr](const json &val) -> std::string {
+      const std::string range_error = check_integer<T>(
+          val, std::integral_constant<bool, std::is_integral<T>::value &&
+                                                !std::is_same<T, bool>::value>());
+      if (!range_error.empty())
+      {
+        return range_error;
+      }
+      try
+      {
+        *ptr = val.get<T>();
+      }
+      catch (json::exception &e)
+      {
+        return std::string("wrong type (") + e.what() + ")";
+      }
+      return "";
+    };
+  }
+
+  //! Check that a value fits in an integer type (so it isn't silently
+  //! truncated or wrapped). Returns an error message (empty if it fits)
+  template <typename T>
+  static std::string check_integer(const json &val, std::true_type)
+  {
+    if (!val.is_number_integer())
+    {
+      return "expected an integer but got " + val.dump();
+    }
+    const bool in_range =
+        (val.is_number_unsigned() || val.get<int64_t>() >= 0)
+            ? val.get<uint64_t>() <=
+                  static_cast<uint64_t>(std::numeric_limits<T>::max())
+            : val.get<int64_t>() >=
+                  static_cast<int64_t>(std::numeric_limits<T>::min());
+    if (!in_range)
+    {
+      return "expected an integer from " +
+             std::to_string(static_cast<long long>(std::numeric_limits<T>::min())) +
+             " to " +
+             std::to_string(static_cast<unsigned long long>(std::numeric_limits<T>::max())) +
+             " but got " + val.dump();
+    }
+    return "";
+  }
+
+  //! Non-integer types are range-checked by the conversion itself
+  template <typename T>
+  static std::string check_integer(const json &, std::false_type)
+  {
+    return "";
+  }
+};
+} // namespace Kilosim
+
+#endif
@@ -9,9 +9,13 @@
 
 #include <nlohmann/json.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 // for convenience
 using json = nlohmann::json;
@@ -22,6 +26,46 @@ namespace Kilosim
  * A ConfigParser is used to parse and process JSON configuration files for
  * user-provided simulation management. It also provides an option to directly
  * save all parameters to the Logger HDF5 file (for consolidation).
+ *
+ * A config file can also describe a parameter sweep, which is expanded into
+ * one config per trial so a single process can run the whole sweep. The
+ * `"sweep"` key holds a list of groups. Each group maps parameter names to
+ * the values to sweep over, either as a list or as an inclusive range:
+ *
+ * ```
+ * {
+ *   "num_robots": 100,
+ *   "seed": 42,
+ *   "repeats": 5,
+ *   "sweep": [
+ *     {"comm_range": [60, 80, 100]},
+ *     {"world_width": [1200, 2400], "world_height": [1200, 2400]},
+ *     {"speed": {"start": 0.5, "stop": 1.0, "step": 0.25}}
+ *   ]
+ * }
+ * ```
+ *
+ * Parameters in the same group are varied together (zipped), so they must
+ * have the same number of values. Groups are combined as a cartesian
+ * product, with the last group varying fastest. Each combination is repeated
+ * `"repeats"` times (default 1). The example above has 3 x 2 x 3 x 5 = 90
+ * trials.
+ *
+ * Trial configs are only created as they're iterated over with #trials, and
+ * are ConfigParsers with the swept values filled in (and without `"sweep"`
+ * and `"repeats"`). Each trial also gets a `"trial_id"` (its index in the
+ * sweep) and a `"seed"` derived from the trial id and the base `"seed"` (or
+ * 0), so every trial is reproducible on its own:
+ *
+ * ```
+ * for (Kilosim::ConfigParser trial : config.trials())
+ * {
+ *   seed_rand(trial.get("seed"));
+ *   // ... run a trial with trial.get(...)
+ * }
+ * ```
+ *
+ * A config without a `"sweep"` has a single trial.
  */
 class ConfigParser
 {
@@ -31,6 +75,77 @@ private:
   //! Internal JSON representation of the config retrieved from file
   json m_config;
 
+  //! Values of one swept parameter
+  struct SweepAxis
+  {
+    //! Name of the parameter
+    std::string name;
+    //! Values it takes
+    std::vector<json> values;
+  };
+  //! Swept parameters, in groups of zipped parameters
+  std::vector<std::vector<SweepAxis>> m_sweep_groups;
+  //! Number of times each combination of swept values is repeated
+  size_t m_repeats = 1;
+  //! Base seed that trial seeds are derived from
+  uint64_t m_base_seed = 0;
+
+  //! Create the config of a single trial of a sweep
+  ConfigParser(const std::string config_file, const json config);
+
+public:
+  /*!
+   * Iterator over the trials of a sweep, which creates each trial's config
+   * when it's dereferenced
+   */
+  class TrialIterator
+  {
+  private:
+    //! Config the sweep comes from
+    const ConfigParser *m_parser;
+    //! Index of the current trial
+    size_t m_trial_id;
+
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef ConfigParser value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ConfigParser *pointer;
+    typedef ConfigParser reference;
+
+    //! Create an iterator at a trial of a sweep
+    TrialIterator(const ConfigParser *parser, const size_t trial_id)
+        : m_parser(parser), m_trial_id(trial_id) {}
+    //! @return Config of the current trial
+    ConfigParser operator*() const { return m_parser->get_trial(m_trial_id); }
+    //! Move to the next trial
+    TrialIterator &operator++()
+    {
+      m_trial_id++;
+      return *this;
+    }
+    //! @return Whether the iterators are at the same trial
+    bool operator==(const TrialIterator &other) const { return m_trial_id == other.m_trial_id; }
+    //! @return Whether the iterators are at different trials
+    bool operator!=(const TrialIterator &other) const { return m_trial_id != other.m_trial_id; }
+  };
+
+  //! Range of trials in a sweep (for range-based for loops)
+  class TrialRange
+  {
+  private:
+    //! Config the sweep comes from
+    const ConfigParser *m_parser;
+
+  public:
+    //! Create the range of all trials of a sweep
+    TrialRange(const ConfigParser *parser) : m_parser(parser) {}
+    //! @return Iterator at the first trial
+    TrialIterator begin() const { return TrialIterator(m_parser, 0); }
+    //! @return Iterator past the last trial
+    TrialIterator end() const { return TrialIterator(m_parser, m_parser->get_num_trials()); }
+  };
+
 public:
   /*!
    * Create a parser to handle the values in the given JSON file
@@ -49,17 +164,54 @@ public:
    * Alternatively, you can directly pass the output to a function taking the
    * relevant type without needing to explicitly specify the type.
    *
+   * This looks up (and converts) the value on every call. For values that
+   * are used repeatedly, read them into variables once with a ConfigBinder.
+   *
    * @param val_name Name/key to get the value for
    * @return Wrapped output value. Use `.type_name()` to get the type
    */
-  json get(const std::string val_name) const;
+  const json &get(const std::string &val_name) const;
   /*!
    * Get the whole JSON object from the parser. This essentially strips the
    * ConfigParser wrapping around the contents, which is not necessary for
    * basic usage.
    * @return Raw nlohmann/json object
    */
-  json get() const;
+  const json &get() const;
+
+  /*!
+   * Get the name of the file the config was loaded from
+   * @return Name/location of the JSON config file
+   */
+  std::string get_filename() const;
+
+  /*!
+   * Get the number of trials in the sweep described by the config
+   * @return Number of trials (1 if the config has no sweep)
+   */
+  size_t get_num_trials() const;
+
+  /*!
+   * Get the config of a single trial of the sweep. Exits if the trial id is
+   * out of range.
+   * @param trial_id Index of the trial (0 to #get_num_trials - 1)
+   * @return Config of the trial, with swept values, `"trial_id"`, and
+   * `"seed"` filled in
+   */
+  ConfigParser get_trial(const size_t trial_id) const;
+
+  /*!
+   * Get all of the trials of the sweep, to iterate over in order. Trial
+   * configs are created one at a time as they're reached.
+   * @return Range of trial configs
+   */
+  TrialRange trials() const;
+
+private:
+  //! Parse the "sweep" and "repeats" keys of the config (exits if invalid)
+  void parse_sweep();
+  //! Parse the values of one swept parameter (exits if invalid)
+  std::vector<json> parse_axis(const std::string name, const json &spec) const;
 };
 } // namespace Kilosim
 
@@ -0,0 +1,236 @@
+/*
+  Kilosim
+
+  World split across MPI processes, each simulating a strip of the arena
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_DISTRIBUTEDWORLD_H
+#define __KILOSIM_DISTRIBUTEDWORLD_H
+
+#include <kilosim/World.h>
+
+#include <mpi.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Kilosim
+{
+//! Function that creates a new Robot (of the type being simulated) on the heap
+typedef std::function<Robot *()> RobotFactory;
+
+/*!
+ * A DistributedWorld simulates one arena across many MPI processes (ranks),
+ * for arenas with more robots than one machine can step quickly. It is only
+ * built when Kilosim is configured with `-DKILOSIM_MPI=ON`.
+ *
+ * The arena is split into vertical strips of equal width, one per rank, and
+ * each rank steps the robots in its strip. Robots near the edge of a strip
+ * (within the halo width) are copied to the neighboring rank every tick they
+ * are needed, so robots on either side of an edge still communicate and
+ * collide with each other:
+ *
+ * - On ticks with communication, each rank receives a copy ("ghost") of its
+ *   neighbors' robots near its edges, delivers the ghosts' messages to its own
+ *   robots, and tells the neighbors which of their messages were delivered
+ *   (so `Robot::received()` is called on the real sender).
+ * - Every tick, each rank receives the next positions of its neighbors'
+ *   robots near its edges, so collisions with them are detected.
+ *
+ * After moving, robots that have left a rank's strip migrate to the
+ * neighboring rank. Ghosts and migrating robots are copied with
+ * `Robot::save_checkpoint()`, so your Robot must save its complete state
+ * (implement `Kilobot::save_state()` and `Kilobot::load_state()`). They are
+ * created on the receiving rank with the RobotFactory.
+ *
+ * Each rank only has the robots in its strip, so a DistributedWorld owns its
+ * robots (they are deleted when they migrate away) and the usual World
+ * methods (e.g., #get_robots, `Logger`, `Viewer`) only see the calling rank's
+ * robots. Use a separate log file per rank (e.g., with #get_rank in the
+ * name), or #gather_poses to collect every robot's pose on one rank.
+ *
+ * Message order differs from a single World, and each rank has its own random
+ * numbers, so results are statistically the same as a single World but not
+ * identical.
+ *
+ * ```
+ * MPI_Init(&argc, &argv);
+ * {
+ *   Kilosim::DistributedWorld world(20000, 20000,
+ *                                   [] { return new MyKilobot(); });
+ *   seed_rand(seed + world.get_rank());
+ *   for (auto &start : starts)
+ *     if (world.in_domain(start.x))
+ *     {
+ *       Kilosim::Robot *robot = new MyKilobot();
+ *       world.add_robot(robot);
+ *       robot->robot_init(start.x, start.y, start.theta);
+ *     }
+ *   for (int t = 0; t < num_ticks; t++)
+ *     world.step();
+ * }
+ * MPI_Finalize();
+ * ```
+ *
+ * Run it with, e.g., `mpirun -n 4 ./my_simulation`.
+ */
+class DistributedWorld : public World
+{
+private:
+  //! Communicator (duplicated from the one given, so messages don't mix
+  //! with the caller's)
+  MPI_Comm m_comm;
+  //! Rank of this process
+  int m_rank;
+  //! Number of ranks
+  int m_num_ranks;
+  //! Rank simulating the strip to the left (MPI_PROC_NULL if none)
+  int m_left;
+  //! Rank simulating the strip to the right (MPI_PROC_NULL if none)
+  int m_right;
+  //! Left edge (mm) of this rank's strip
+  double m_x0;
+  //! Right edge (mm) of this rank's strip
+  double m_x1;
+  //! Distance (mm) from an edge within which robots are copied to neighbors
+  const double m_halo_width;
+  //! Creates ghosts and migrating robots
+  RobotFactory m_factory;
+
+  //! Indices of robots within the halo of the left edge (updated every step)
+  std::vector<size_t> m_halo_left;
+  //! Indices of robots within the halo of the right edge
+  std::vector<size_t> m_halo_right;
+  //! Copies of the neighbors' robots near the edges (reused between ticks)
+  std::vector<std::unique_ptr<Robot>> m_ghosts;
+  //! Number of ghosts from the left neighbor (first in m_ghosts)
+  size_t m_num_ghosts_left = 0;
+  //! Number of ghosts from the right neighbor (after those from the left)
+  size_t m_num_ghosts_right = 0;
+
+  //! Find the robots within the halo of each edge
+  void find_halo();
+  //! Copy the robots near each edge to the neighbors as ghosts (and receive
+  //! theirs)
+  void exchange_ghosts();
+  //! Deliver the ghosts' messages to this rank's robots, then tell the
+  //! neighbors which of their robots' messages were delivered
+  void communicate_ghosts();
+  /*!
+   * Send the next positions of the robots near each edge to the neighbors,
+   * and append theirs to `new_poses`
+   * @param new_poses Next positions of this rank's robots
+   */
+  void exchange_ghost_poses(std::vector<RobotPose> &new_poses);
+  //! Send robots that have left this rank's strip to the neighbors (and
+  //! receive the robots that have entered it)
+  void migrate();
+
+  /*!
+   * Serialize robots with Robot::save_checkpoint
+   * @param indices Indices of the robots to serialize
+   */
+  std::string serialize_robots(const std::vector<size_t> &indices) const;
+  /*!
+   * Restore the Robots serialized by #serialize_robots
+   * @param data Serialized robots
+   * @param robots Robots to load into (created with the factory as needed;
+   * the first `start` are left alone)
+   * @param start Index of the first Robot to load into
+   * @return Number of robots loaded
+   */
+  size_t deserialize_robots(const std::string &data,
+                            std::vector<std::unique_ptr<Robot>> &robots,
+                            const size_t start);
+
+  /*!
+   * Send a buffer to each neighbor and receive one from each
+   * @param to_left Sent to the left neighbor
+   * @param to_right Sent to the right neighbor
+   * @param from_left Received from the left neighbor (empty if none)
+   * @param from_right Received from the right neighbor (empty if none)
+   */
+  template <class Buffer>
+  void exchange(const Buffer &to_left, const Buffer &to_right,
+                Buffer &from_left, Buffer &from_right) const;
+
+public:
+  /*!
+   * Create this rank's part of a World split across the ranks of an MPI
+   * communicator (collective: every rank must construct it). MPI must already
+   * be initialized, and the DistributedWorld must be destroyed before
+   * `MPI_Finalize()`.
+   *
+   * Throws a `std::runtime_error` if the strips are narrower than the halo,
+   * or the halo is narrower than the collision diameter (`2 * RADIUS`).
+   *
+   * @param arena_width Width of the whole arena in mm
+   * @param arena_height Height of the whole arena in mm
+   * @param factory Creates a new Robot of the type being simulated (e.g.,
+   * `[] { return new MyKilobot(); }`)
+   * @param light_pattern_src Name of image file of the light pattern to use
+   * (see World::World)
+   * @param num_threads How many threads each rank uses (see World::World)
+   * @param halo_width Distance (mm) from the edge of a strip within which
+   * robots are copied to the neighboring rank. It must be at least the
+   * robots' communication range (and the collision diameter).
+   * @param comm Communicator of the ranks to split the World across
+   */
+  DistributedWorld(const double arena_width, const double arena_height,
+                   const RobotFactory factory,
+                   const std::string light_pattern_src = "",
+                   const uint32_t num_threads = 0,
+                   const double halo_width = 100,
+                   const MPI_Comm comm = MPI_COMM_WORLD);
+  //! Destroy the robots and free the communicator
+  ~DistributedWorld();
+
+  /*!
+   * Add a robot to this rank's strip. The DistributedWorld takes ownership of
+   * it (it is deleted when it migrates to another rank, or when the
+   * DistributedWorld is destroyed). Only add robots for which #in_domain is
+   * true.
+   * @param robot Robot to add, created on the heap
+   */
+  void add_robot(Robot *robot);
+
+  /*!
+   * Run a step of the simulator on every rank (collective: every rank must
+   * call it every tick)
+   */
+  void step() override;
+
+  /*!
+   * Check whether a position is in this rank's strip (i.e., whether a robot
+   * there should be added on this rank)
+   * @param x x-position (mm)
+   */
+  bool in_domain(const double x) const;
+
+  //! @return Rank of this process
+  int get_rank() const;
+
+  //! @return Number of ranks the World is split across
+  int get_num_ranks() const;
+
+  /*!
+   * Get the total number of robots on all ranks (collective)
+   * @return Number of robots in the whole World
+   */
+  uint64_t get_total_robots() const;
+
+  /*!
+   * Collect the poses of every robot on one rank (collective), e.g., to log
+   * or visualize the whole World
+   * @param root Rank that receives the poses
+   * @return Poses of all robots, grouped by rank (empty on other ranks)
+   */
+  std::vector<RobotPose> gather_poses(const int root = 0) const;
+};
+} // namespace Kilosim
+
+#endif
@@ -0,0 +1,217 @@
+/*
+  Kilosim
+
+  Streams raw robot states to a memory-mapped binary file, as a lightweight
+  alternative to logging trajectories in HDF5
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_FRAMESTREAM_H
+#define __KILOSIM_FRAMESTREAM_H
+
+#include <kilosim/MappedFile.h>
+#include <kilosim/World.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Kilosim
+{
+//! Identifies a frame stream file (the first 8 bytes of the file)
+constexpr char FRAME_STREAM_MAGIC[8] = {'K', 'S', 'I', 'M', 'F', 'R', 'M', 'S'};
+//! Version of the frame stream layout
+constexpr uint32_t FRAME_STREAM_VERSION = 1;
+
+/*!
+ * Header at the start of a frame stream file, describing its layout.
+ * All values are in the byte order of the machine that wrote the file.
+ */
+struct FrameStreamHeader
+{
+  //! Always FRAME_STREAM_MAGIC
+  char magic[8];
+  //! Layout version (FRAME_STREAM_VERSION)
+  uint32_t version;
+  //! Size of this header in bytes (frames start at this offset)
+  uint32_t header_size;
+  //! Number of robots in every frame
+  uint32_t num_robots;
+  //! Size of one frame in bytes
+  uint32_t frame_size;
+  //! Number of complete frames in the file
+  uint64_t num_frames;
+  //! Width of the World in mm
+  double arena_width;
+  //! Height of the World in mm
+  double arena_height;
+  //! Simulation ticks per second
+  double tick_rate;
+  //! Unused (pads the header to 64 bytes)
+  char reserved[8];
+};
+static_assert(sizeof(FrameStreamHeader) == 64,
+              "FrameStreamHeader must be 64 bytes");
+
+/*!
+ * State of one robot in a frame: position (mm), rotation (radians), and RGB
+ * LED color (0-1), matching the Robot's public values.
+ */
+struct FrameRobotState
+{
+  //! Robot's x-position
+  double x;
+  //! Robot's y-position
+  double y;
+  //! Robot's rotation, where 0 points along x-axis and positive is CCW
+  double theta;
+  //! RGB LED color
+  double color[3];
+};
+
+/*!
+ * Appends fixed-layout binary frames of every Robot's state to a
+ * memory-mapped file.
+ *
+ * This is an alternative to trajectory logging with the Logger for tools
+ * that only need raw frames, without HDF5's overhead on every append. It is
+ * usually added to a Logger with Logger::add_frame_stream (so frames are
+ * saved by Logger::log_state or Logger::log_due), but can also be used on
+ * its own. The file is a 64-byte FrameStreamHeader followed by frames, each
+ * of which is the simulation time (a `double`, in seconds) followed by one
+ * FrameRobotState per Robot:
+ *
+ * ```
+ * [header][time][robot 0]...[robot n-1][time][robot 0]...[robot n-1]...
+ * ```
+ *
+ * The file grows in large steps as frames are appended, and is trimmed to
+ * its exact size when the writer is destroyed. The header's `num_frames` is
+ * updated after every frame, so the file can be read while it's written.
+ *
+ * It can be read with no copying with a FrameStreamReader, with numpy
+ * (`np.memmap` with a structured dtype, offset by `header_size`), or
+ * converted to the Logger's HDF5 layout with #frame_stream_to_h5.
+ */
+class FrameStreamWriter
+{
+private:
+  //! World whose Robots are saved
+  World &m_world;
+  //! Mapped output file
+  MappedFile m_file;
+  //! Number of robots in every frame (fixed when the writer is created)
+  uint32_t m_num_robots;
+  //! Size of one frame in bytes
+  size_t m_frame_size;
+  //! Number of frames written
+  uint64_t m_num_frames = 0;
+
+public:
+  /*!
+   * Create (or overwrite) a frame stream file for the Robots in a World
+   *
+   * The number of Robots in each frame is fixed to the number in the World
+   * when the writer is created.
+   *
+   * @param world World whose Robots will be saved
+   * @param filename Name/location of the binary file to create
+   */
+  FrameStreamWriter(World &world, const std::string filename);
+  //! Trim the file to the frames written and close it
+  ~FrameStreamWriter();
+
+  /*!
+   * Append a frame with the current time and state of every Robot
+   */
+  void log_state();
+
+  /*!
+   * Get the number of frames written so far
+   * @return Number of frames in the file
+   */
+  uint64_t get_num_frames() const;
+
+private:
+  //! Header at the start of the mapped file
+  FrameStreamHeader *header();
+};
+
+/*!
+ * Zero-copy reader of a frame stream file written by FrameStreamWriter.
+ *
+ * The file is memory-mapped, and frames are accessed by pointers directly
+ * into the mapping, so only the parts that are read are loaded from disk.
+ */
+class FrameStreamReader
+{
+private:
+  //! Mapped input file
+  MappedFile m_file;
+  //! Number of complete frames available
+  uint64_t m_num_frames;
+
+public:
+  /*!
+   * Map a frame stream file for reading. Throws a `std::runtime_error` if
+   * the file is not a frame stream or its header is inconsistent with its
+   * layout or size.
+   * @param filename Name/location of the binary file
+   */
+  FrameStreamReader(const std::string filename);
+
+  /*!
+   * Get the header describing the file layout
+   * @return Header at the start of the file
+   */
+  const FrameStreamHeader &header() const;
+
+  /*!
+   * Get the number of complete frames in the file (when it was opened)
+   * @return Number of frames
+   */
+  uint64_t get_num_frames() const;
+
+  /*!
+   * Get the time of a frame
+   * @param frame Index of the frame
+   * @return Simulation time (seconds) when the frame was saved
+   */
+  double get_time(const uint64_t frame) const;
+
+  /*!
+   * Get the robot states in a frame (without copying)
+   * @param frame Index of the frame
+   * @return Pointer to header().num_robots states, valid as long as the
+   * reader exists
+   */
+  const FrameRobotState *get_robots(const uint64_t frame) const;
+
+private:
+  //! Start of a frame in the mapping
+  const char *frame_start(const uint64_t frame) const;
+};
+
+/*!
+ * Convert a frame stream file to the same HDF5 layout the Logger uses.
+ *
+ * The frames are saved in the group `trial_#` of the HDF5 file (which is
+ * created if it doesn't exist), with a `time` series and `x`, `y`, and
+ * `theta` datasets (`[n x t]`, like aggregators with one value per Robot)
+ * and a `color` dataset (`[n x 3 x t]`).
+ *
+ * @param stream_file Name/location of the frame stream file to read
+ * @param h5_file Name/location of the HDF5 file to write. It is created if it
+ * doesn't exist; if it exists but can't be opened as HDF5, a
+ * `std::runtime_error` is thrown (and the file is left alone).
+ * @param trial_num Number of the trial group to save the frames in
+ * @param overwrite_trial Whether to replace the trial group if it already
+ * exists. If false, a `std::runtime_error` is thrown instead.
+ */
+void frame_stream_to_h5(const std::string stream_file,
+                        const std::string h5_file, const int trial_num,
+                        const bool overwrite_trial = false);
+} // namespace Kilosim
+
+#endif
@@ -3,6 +3,7 @@
 #undef RGB
 
 #include <kilosim/Robot.h>
+#include <kilosim/Checkpoint.h>
 #include <kilosim/Random.h>
 
 namespace Kilosim
@@ -187,6 +188,24 @@ protected:
 	 */
 	virtual void message_tx_success() = 0;
 
+	/*!
+	 * [User API] Save the state of your controller to a checkpoint
+	 *
+	 * Implement this (and `load_state`) if you want to use
+	 * `World::save_checkpoint()` and `World::load_checkpoint()`. Write every
+	 * member variable that changes during the simulation, for example with
+	 * `checkpoint_write(out, my_variable)`. By default, nothing is saved.
+	 */
+	virtual void save_state(std::ostream &) const {}
+
+	/*!
+	 * [User API] Restore the state of your controller from a checkpoint
+	 *
+	 * Read back everything written by `save_state`, in the same order, for
+	 * example with `checkpoint_read(in, my_variable)`.
+	 */
+	virtual void load_state(std::istream &) {}
+
 	/***************************************************************************
 	 * KILOLIB API FUNCTIONS
 	 **************************************************************************/
@@ -284,13 +303,19 @@ protected:
 	 */
 	int16_t get_ambientlight()
 	{
+		if (m_light_reading >= 0)
+		{
+			// Already read at this pose (usually by the World, for all robots)
+			return m_light_reading;
+		}
 		if (m_light_pattern)
 		{
 			// Get point at front/nose of robot
-			int pos_x = x + RADIUS * 1 * cos(theta);
-			int pos_y = y + RADIUS * 1 * sin(theta);
+			int pos_x, pos_y;
+			light_sensor_position(pos_x, pos_y);
 			// Get the 10-bit light intensity from the robot
-			return m_light_pattern->get_ambientlight(pos_x, pos_y);
+			m_light_reading = m_light_pattern->get_ambientlight(pos_x, pos_y);
+			return m_light_reading;
 		}
 		else
 		{
@@ -363,6 +388,30 @@ protected:
 	{
 		return buffer;
 	}
+
+	void save_robot_state(std::ostream &out) const final
+	{
+		checkpoint_write(out, left_ready);
+		checkpoint_write(out, right_ready);
+		checkpoint_write(out, m_turn_right);
+		checkpoint_write(out, m_turn_left);
+		checkpoint_write(out, distance_measurement);
+		checkpoint_write(out, message_sent);
+		checkpoint_write(out, kilo_ticks);
+		save_state(out);
+	}
+
+	void load_robot_state(std::istream &in) final
+	{
+		checkpoint_read(in, left_ready);
+		checkpoint_read(in, right_ready);
+		checkpoint_read(in, m_turn_right);
+		checkpoint_read(in, m_turn_left);
+		checkpoint_read(in, distance_measurement);
+		checkpoint_read(in, message_sent);
+		checkpoint_read(in, kilo_ticks);
+		load_state(in);
+	}
 };
 
 } // namespace Kilosim
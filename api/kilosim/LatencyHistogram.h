@@ -0,0 +1,120 @@
+/*
+  Kilosim
+
+  Fixed-size, log-linear histograms of durations, for percentile timing
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_LATENCYHISTOGRAM_H
+#define __KILOSIM_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+namespace Kilosim
+{
+/*!
+ * A LatencyHistogram counts durations (in nanoseconds) in log-linear buckets,
+ * so it can report percentiles (e.g., the slowest 1% of steps) without
+ * storing every duration.
+ *
+ * Durations under 2^#SUB_BUCKET_BITS ns get their own bucket. Above that,
+ * each power of 2 is split into 2^#SUB_BUCKET_BITS equal buckets, so
+ * percentiles are within 1/2^#SUB_BUCKET_BITS (about 6%) of the true value.
+ * Durations are counted up to 2^#MAX_EXPONENT ns (about 18 minutes); longer
+ * ones are counted in the last bucket. The exact maximum, total, and count
+ * are also kept.
+ *
+ * Recording is a few integer operations and never allocates or throws, so it
+ * can be used on every tick. A histogram isn't thread-safe; record from a
+ * single thread (or use one histogram per thread).
+ */
+class LatencyHistogram
+{
+public:
+  //! Number of bits of precision within each power of 2
+  static constexpr uint32_t SUB_BUCKET_BITS = 4;
+  //! Durations of 2^MAX_EXPONENT ns and longer go in the last bucket
+  static constexpr uint32_t MAX_EXPONENT = 40;
+  //! Number of sub-buckets in each power of 2
+  static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  //! Total number of buckets
+  static constexpr uint32_t NUM_BUCKETS =
+      (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+  //! Number of durations in each bucket
+  std::array<uint64_t, NUM_BUCKETS> m_counts;
+  //! Number of durations recorded
+  uint64_t m_count = 0;
+  //! Sum of all durations recorded (ns)
+  uint64_t m_total = 0;
+  //! Longest duration recorded (ns)
+  uint64_t m_max = 0;
+
+public:
+  //! Create an empty histogram
+  LatencyHistogram() noexcept;
+
+  /*!
+   * Count a duration
+   * @param ns Duration in nanoseconds
+   */
+  void record(const uint64_t ns) noexcept
+  {
+    m_counts[bucket_index(ns)]++;
+    m_count++;
+    m_total += ns;
+    if (ns > m_max)
+      m_max = ns;
+  }
+
+  //! Remove all recorded durations
+  void reset() noexcept;
+
+  //! @return Number of durations recorded
+  uint64_t get_count() const noexcept;
+
+  //! @return Sum of all recorded durations in seconds
+  double get_total() const noexcept;
+
+  //! @return Mean recorded duration in seconds (0 if empty)
+  double get_mean() const noexcept;
+
+  //! @return Longest recorded duration in seconds (0 if empty)
+  double get_max() const noexcept;
+
+  /*!
+   * Get a percentile of the recorded durations. This is the upper edge of
+   * the bucket containing the percentile (but no more than the maximum), so
+   * it never underestimates by more than the bucket width.
+   * @param percentile Percentile to get, from 0 to 100 (e.g., 99 for p99)
+   * @return Duration in seconds (0 if empty)
+   */
+  double get_percentile(const double percentile) const noexcept;
+
+  //! Add all the durations recorded in another histogram to this one
+  void merge(const LatencyHistogram &other) noexcept;
+
+private:
+  //! Get the bucket a duration is counted in
+  static uint32_t bucket_index(const uint64_t ns) noexcept
+  {
+    if (ns < SUB_BUCKETS)
+      return ns;
+    const uint32_t exponent = 63 - __builtin_clzll(ns);
+    if (exponent >= MAX_EXPONENT)
+      return NUM_BUCKETS - 1;
+    const uint32_t shift = exponent - SUB_BUCKET_BITS;
+    // The leading bit is implied by the exponent, so only the next
+    // SUB_BUCKET_BITS bits pick the sub-bucket
+    return (shift + 1) * SUB_BUCKETS + ((ns >> shift) & (SUB_BUCKETS - 1));
+  }
+
+  //! Get the largest duration (ns) counted in a bucket
+  static uint64_t bucket_upper(const uint32_t index) noexcept;
+};
+} // namespace Kilosim
+
+#endif
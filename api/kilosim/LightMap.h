@@ -0,0 +1,192 @@
+/*
+  Kilosim
+
+  Tiled, multiresolution light maps for large arenas, read lazily from disk
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_LIGHTMAP_H
+#define __KILOSIM_LIGHTMAP_H
+
+#include <kilosim/MappedFile.h>
+
+#include <SFML/Graphics.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Kilosim
+{
+//! Identifies a light map file (the first 8 bytes of the file)
+constexpr char LIGHT_MAP_MAGIC[8] = {'K', 'S', 'I', 'M', 'L', 'M', 'A', 'P'};
+//! Version of the light map layout
+constexpr uint32_t LIGHT_MAP_VERSION = 1;
+
+/*!
+ * Header at the start of a light map file. It is followed by one
+ * LightMapLevel per level of the mip pyramid, then the tiles.
+ */
+struct LightMapHeader
+{
+  //! Always LIGHT_MAP_MAGIC
+  char magic[8];
+  //! Layout version (LIGHT_MAP_VERSION)
+  uint32_t version;
+  //! Width and height (in texels) of every tile
+  uint32_t tile_size;
+  //! Number of levels in the mip pyramid (level 0 is full resolution)
+  uint32_t num_levels;
+  //! Unused (pads the header to 24 bytes)
+  uint32_t reserved;
+};
+static_assert(sizeof(LightMapHeader) == 24, "LightMapHeader must be 24 bytes");
+
+//! Layout of one level of a light map's mip pyramid
+struct LightMapLevel
+{
+  //! Width of the level in texels
+  uint32_t width;
+  //! Height of the level in texels
+  uint32_t height;
+  //! Number of columns of tiles
+  uint32_t tiles_x;
+  //! Number of rows of tiles
+  uint32_t tiles_y;
+  //! Offset (bytes from the start of the file) of the level's first tile
+  uint64_t offset;
+};
+static_assert(sizeof(LightMapLevel) == 24, "LightMapLevel must be 24 bytes");
+
+/*!
+ * A light map is a precomputed, tiled mip pyramid of 10-bit light
+ * intensities, for light patterns too large to keep in memory as an image.
+ *
+ * Build one from an image once with #build_light_map, then use it with
+ * LightPattern::set_light_map (or World::set_light_map). Each level is half
+ * the resolution of the one before, and is split into square tiles stored
+ * contiguously in the file, with rows going from the bottom of the World up.
+ *
+ * Tiles are only read when they're first sampled, so memory use and startup
+ * time depend on the regions robots actually visit. The file is either
+ * memory-mapped (and tiles are paged in by the OS), or tiles are read into
+ * memory on first use. Sampling is thread-safe in both cases.
+ *
+ * Light is sampled with bilinear interpolation between the centers of the
+ * 4 nearest texels.
+ */
+class LightMap
+{
+private:
+  //! Name/location of the light map file
+  std::string m_filename;
+  //! Mapped file (if memory-mapped)
+  std::unique_ptr<MappedFile> m_file;
+  //! File descriptor for reading tiles (if not memory-mapped)
+  int m_fd = -1;
+  //! Width and height (in texels) of every tile
+  uint32_t m_tile_size;
+  //! Layout of every level of the pyramid
+  std::vector<LightMapLevel> m_levels;
+  //! Index in m_tiles of the first tile of each level
+  std::vector<size_t> m_level_first_tile;
+  //! Tiles read so far (null if not yet read), if not memory-mapped
+  std::unique_ptr<std::atomic<uint16_t *>[]> m_tiles;
+  //! Total number of tiles in all levels
+  size_t m_num_tiles = 0;
+  //! Number of tiles read so far, if not memory-mapped
+  mutable std::atomic<size_t> m_num_loaded;
+
+public:
+  /*!
+   * Open a light map file written by #build_light_map. Throws a
+   * `std::runtime_error` if it isn't a valid light map.
+   * @param filename Name/location of the light map file
+   * @param memory_map If true, map the file into memory. If false, tiles are
+   * read (and kept in memory) the first time they're sampled.
+   */
+  LightMap(const std::string filename, const bool memory_map = true);
+  //! Close the file and free any tiles read
+  ~LightMap();
+
+  LightMap(const LightMap &) = delete;
+  LightMap &operator=(const LightMap &) = delete;
+
+  //! @return Number of levels in the mip pyramid
+  uint32_t get_num_levels() const;
+  //! @return Width (texels) of a level of the pyramid
+  uint32_t get_width(const uint32_t level) const;
+  //! @return Height (texels) of a level of the pyramid
+  uint32_t get_height(const uint32_t level) const;
+
+  /*!
+   * Get the 10-bit light intensity of a single texel
+   * @param level Level of the pyramid
+   * @param x Column of the texel (from left)
+   * @param y Row of the texel (from bottom)
+   * @return 10-bit light intensity
+   */
+  uint16_t get_texel(const uint32_t level, const uint32_t x,
+                     const uint32_t y) const;
+
+  /*!
+   * Get the bilinearly interpolated light intensity at a position in a level
+   * of the pyramid. Positions outside the level get the values at its edges.
+   * @param level Level of the pyramid
+   * @param u Horizontal position, in texels from the left edge
+   * @param v Vertical position, in texels from the bottom edge
+   * @return Light intensity (0-1023)
+   */
+  double sample(const uint32_t level, const double u, const double v) const;
+
+  /*!
+   * Get an image of a level of the pyramid (in grayscale), e.g. to display
+   * the light pattern. This reads the whole level, so use a coarse level.
+   * @param level Level of the pyramid
+   * @return Image of the level, with the top row first
+   */
+  sf::Image get_image(const uint32_t level) const;
+
+  /*!
+   * Get the number of tiles read from disk so far. (If memory-mapped, the OS
+   * loads tiles instead, so this is always 0.)
+   * @return Number of tiles in memory
+   */
+  size_t get_num_loaded_tiles() const;
+
+private:
+  //! Get a tile's texels (reading it if needed)
+  const uint16_t *get_tile(const uint32_t level, const uint32_t tile_x,
+                           const uint32_t tile_y) const;
+  /*!
+   * Read and check the header and level table, and check that every level
+   * fits in the file (throws a `std::runtime_error` if not)
+   * @param file_size Size of the file in bytes
+   */
+  void load_layout(const uint64_t file_size);
+  //! Read bytes from the file at an offset (from the mapping, if mapped)
+  void read_bytes(void *dest, const size_t size, const uint64_t offset) const;
+  //! Read bytes from the file at an offset (if not memory-mapped)
+  void read_at(void *dest, const size_t size, const uint64_t offset) const;
+};
+
+/*!
+ * Build a light map file from an image. The image is converted to 10-bit
+ * light intensity the same way as LightPattern::set_light_pattern, then
+ * downsampled (by averaging 2x2 texels) until a level fits in a single tile.
+ *
+ * This loads the whole image, so it's meant to be done once, offline, e.g.
+ * in a separate program before running simulations.
+ *
+ * @param img_src Filename (+location) of the source image
+ * @param map_file Name/location of the light map file to write
+ * @param tile_size Width and height (in texels) of each tile
+ */
+void build_light_map(const std::string img_src, const std::string map_file,
+                     const uint32_t tile_size = 64);
+} // namespace Kilosim
+
+#endif
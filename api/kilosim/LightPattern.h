@@ -7,24 +7,89 @@
 #ifndef __KILOSIM_LIGHTPATTERN_H
 #define __KILOSIM_LIGHTPATTERN_H
 
+#include <kilosim/LightMap.h>
+
 #include <SFML/Graphics.hpp>
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Kilosim
 {
+/*!
+ * Function that gives the light intensity at a position in the World at a
+ * point in time, for procedural light patterns (set with
+ * LightPattern::set_light_function).
+ *
+ * @param x Position (from left) in mm
+ * @param y Position (from bottom) in mm
+ * @param t Simulation time in seconds
+ * @return Light intensity, from 0 (black) to 1 (white)
+ */
+typedef std::function<double(double x, double y, double t)> lightFunc;
+
+/*!
+ * A single image of the light pattern, with its precomputed 10-bit light
+ * intensity at every pixel
+ */
+struct LightFrame
+{
+  //! Image of the light (full color)
+  sf::Image image;
+  //! 10-bit light intensity of every pixel of the image, precomputed so
+  //! sensor readings don't convert colors. Rows go from the bottom of the
+  //! image up (like World coordinates).
+  std::vector<uint16_t> luminance;
+};
+
 /*!
  * A LightPattern represents the visible light intensity of the World. This
  * makes the simplifying assumption that perceived light intensity from the
  * sensors is linearly proportional to the luminosity. Any non-monochrome images
  * will be converted to grayscale by a luminosity for computing light intensity.
+ *
+ * The light can be a single static image, or change over time:
+ * - A sequence of image files, each shown for the same duration
+ *   (#set_light_sequence). The images can all be loaded up front, or loaded
+ *   one ahead by a background thread so long sequences don't have to fit in
+ *   memory.
+ * - A function of position and time (#set_light_function), evaluated on a
+ *   grid whenever the pattern is due to change.
+ *
+ * For very large arenas, the light can instead come from a tiled LightMap
+ * file (#set_light_map), which is read lazily and sampled with bilinear
+ * interpolation.
+ *
+ * Dynamic patterns change when #update is called with a new time (which the
+ * World does at the start of every step). Every change increments the
+ * #get_version counter, so displays know when to reload the image.
  */
 class LightPattern
 {
 private:
-  //! Ambient light in the world
-  sf::Image m_light_pattern;
+  //! How the light pattern changes over time
+  enum class Mode
+  {
+    //! A single image (or none)
+    STATIC,
+    //! A sequence of images loaded up front
+    SEQUENCE,
+    //! A sequence of images prefetched by a background thread
+    STREAMED_SEQUENCE,
+    //! Function of position and time evaluated onto a grid
+    FUNCTION,
+    //! Tiled light map file
+    MAP
+  };
+
+  class FramePrefetcher;
+
+  //! Current light (null if no source has been set)
+  std::shared_ptr<const LightFrame> m_frame;
   //! Width of the World (in mm), as set at initialization
   double m_arena_width;
   //! Dimensions of internal image (to minimize recomputation)
@@ -33,6 +98,47 @@ private:
   double m_scale;
   //! Whether an image has been provided for light. (If not, always black)
   bool m_has_source;
+  //! Incremented every time the light changes
+  uint32_t m_version = 0;
+  //! How the light changes over time
+  Mode m_mode = Mode::STATIC;
+  //! Time (seconds) of the most recent #update
+  double m_time = 0;
+
+  //! Image files of a frame sequence
+  std::vector<std::string> m_frame_srcs;
+  //! Preloaded frames of a sequence (shared between copies, since they're
+  //! never modified)
+  std::shared_ptr<const std::vector<std::shared_ptr<const LightFrame>>> m_frames;
+  //! Background loader of a streamed sequence
+  std::unique_ptr<FramePrefetcher> m_prefetcher;
+  //! How long each frame of a sequence is shown (seconds)
+  double m_frame_duration;
+  //! Time (seconds) when the sequence was set, when its first frame is shown
+  double m_sequence_start = 0;
+  //! Whether a sequence restarts after its last frame (otherwise it stays on
+  //! the last frame)
+  bool m_loop;
+  //! Index of the currently shown frame of a sequence
+  int64_t m_frame_index = -1;
+
+  //! Procedural light function
+  lightFunc m_light_func;
+  //! Height of the World (mm), covered by the procedural grid
+  double m_arena_height;
+  //! Size (mm) of each cell of the procedural grid
+  double m_func_resolution;
+  //! How often (seconds) the procedural grid is re-evaluated
+  double m_update_period;
+  //! Index of the period the procedural grid was last evaluated for
+  int64_t m_func_step = -1;
+
+  //! Tiled light map (shared between copies, since sampling is thread-safe)
+  std::shared_ptr<const LightMap> m_light_map;
+  //! Level of the light map's pyramid that is sampled
+  uint32_t m_map_level;
+  //! Scaling between world coordinates and light map level texels
+  double m_map_scale;
 
 public:
   /*!
@@ -43,6 +149,12 @@ public:
    * get_light_pattern
    */
   LightPattern();
+  //! Copy a LightPattern (a streamed sequence gets its own prefetch thread)
+  LightPattern(const LightPattern &other);
+  //! Copy a LightPattern (a streamed sequence gets its own prefetch thread)
+  LightPattern &operator=(const LightPattern &other);
+  //! Stop the prefetch thread (if any)
+  ~LightPattern();
 
   /*!
    * Initialize the LightPattern from the given source image file
@@ -67,13 +179,26 @@ public:
    * space Position refers to the position in Kilobot world coordinates, where
    * (0, 0) is the bottom left.
    * If no light source image has been provided (by constructor or
-   * set_light_pattern), it will always return 0 (black).
+   * set_light_pattern), it will always return 0 (black). Positions outside
+   * the World get the value at the nearest edge.
    * @param x Robot x position (from left) in mm
    * @param y Robot y position (from bottom) in mm
    * @return 10-bit light value (matching kilobot API)
    */
   uint16_t get_ambientlight(const double x, const double y) const;
 
+  /*!
+   * Get the 10-bit light intensity at many positions at once (e.g., the
+   * light sensors of every robot). This gives the same values as
+   * #get_ambientlight, but the lookups are vectorized.
+   * @param n Number of positions
+   * @param x x positions (from left) in mm
+   * @param y y positions (from bottom) in mm
+   * @param out Light values (filled for all n positions)
+   */
+  void get_ambientlight_batch(const size_t n, const double *x,
+                              const double *y, uint16_t *out) const;
+
   /*!
    * Get the Internal Image representing the light pattern.
    * @return Image of the light pattern (full color)
@@ -86,11 +211,86 @@ public:
    */
   bool has_source() const;
 
+  /*!
+   * Get the version of the light, which is incremented every time it
+   * changes (by setting a new source or by a dynamic pattern changing)
+   * @return Version of the current light
+   */
+  uint32_t get_version() const;
+
   /*!
    * Set the light pattern to a new image source file
    * @param img_src Filename (+location) of the new light source image
    */
   void set_light_pattern(const std::string img_src);
+
+  /*!
+   * Set the light pattern to a sequence of image files, each shown for the
+   * same amount of time, starting from the time of the most recent #update.
+   * All images must have the aspect ratio of the World.
+   *
+   * @param img_srcs Filenames (+locations) of the images, in order
+   * @param frame_duration How long each image is shown (seconds)
+   * @param loop Whether to restart the sequence after the last image. If
+   * false, the last image stays after the sequence ends.
+   * @param prefetch If false, all images are loaded now. If true, images are
+   * loaded by a background thread while the previous image is shown (so only
+   * two are in memory at once). Jumping to a different time (e.g., by loading
+   * a checkpoint) waits for the needed image to load.
+   */
+  void set_light_sequence(const std::vector<std::string> img_srcs,
+                          const double frame_duration, const bool loop = true,
+                          const bool prefetch = false);
+
+  /*!
+   * Set the light pattern to a function of position and time. The function
+   * is evaluated at the center of every cell of a grid covering the World
+   * (in parallel, so it must be thread-safe), once per update period.
+   *
+   * @param light_func Function giving the light intensity (0-1) at a
+   * position and time
+   * @param arena_height Height of the World in mm
+   * @param resolution Width/height of each grid cell in mm
+   * @param update_period How often (seconds) to re-evaluate the function. If
+   * 0, it's evaluated on every #update with a new time.
+   */
+  void set_light_function(const lightFunc light_func,
+                          const double arena_height,
+                          const double resolution,
+                          const double update_period);
+
+  /*!
+   * Set the light pattern to a tiled light map file (built with
+   * #build_light_map). The light map must have the aspect ratio of the World.
+   * Light is sampled with bilinear interpolation, and tiles are only read
+   * when robots sense light in them.
+   *
+   * The image from #get_light_pattern (e.g., for display) comes from a
+   * coarse level of the pyramid.
+   *
+   * @param map_file Name/location of the light map file
+   * @param level Level of the pyramid to sense light from (0 is full
+   * resolution; higher levels use less memory)
+   * @param memory_map Whether to memory-map the file (otherwise tiles are
+   * read into memory when first needed)
+   */
+  void set_light_map(const std::string map_file, const uint32_t level = 0,
+                     const bool memory_map = true);
+
+  /*!
+   * Update a dynamic light pattern to the given time. This does nothing if
+   * the light doesn't need to change.
+   * @param t Simulation time (seconds)
+   */
+  void update(const double t);
+
+private:
+  //! Use a new frame as the current light
+  void set_frame(const std::shared_ptr<const LightFrame> frame);
+  //! Get the frame of a sequence shown at a time
+  int64_t frame_index(const double t) const;
+  //! Stop any dynamic pattern and its prefetch thread
+  void clear_dynamic();
 };
 } // namespace Kilosim
-#endif
\ No newline at end of file
+#endif
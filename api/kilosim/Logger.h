@@ -13,11 +13,13 @@
 #include <kilosim/Robot.h>
 #include <kilosim/World.h>
 #include <kilosim/ConfigParser.h>
+#include <kilosim/FrameStream.h>
 
 #include <H5PacketTable.h>
 #include <H5Cpp.h>
 #include <nlohmann/json.hpp>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -27,6 +29,29 @@ using json = nlohmann::json;
 
 namespace Kilosim
 {
+/*!
+ * Compact, fixed-point pose and color of one Robot, as saved by
+ * Logger::add_trajectory.
+ *
+ * Positions are counts of the trajectory's position resolution (e.g., 0.1 mm),
+ * the angle is a fraction of a full turn (65536 counts per 2*pi radians), and
+ * each color component is 0-255.
+ */
+struct QuantizedPose
+{
+  //! x-position in units of the position resolution
+  uint16_t x;
+  //! y-position in units of the position resolution
+  uint16_t y;
+  //! Rotation, where 65536 is a full turn (2*pi radians)
+  uint16_t theta;
+  //! RGB LED color, 0-255 per component
+  uint8_t color[3];
+  //! Unused (always 0, so the padding saved with each pose is deterministic)
+  uint8_t pad;
+};
+static_assert(sizeof(QuantizedPose) == 10, "QuantizedPose must be 10 bytes");
+
 /*!
  * A Logger is used to save [HDF5](https://portal.hdfgroup.org/display/support)
  * files containing parameters and continuous state information for multiple
@@ -64,6 +89,31 @@ namespace Kilosim
  * where `t` is the number of time steps when data was logged, and
  * `aggregator_1` and `aggregator_2` were specified by the user.
  *
+ * Aggregators can also be given their own logging period (see
+ * #add_aggregator). These are logged by #log_due rather than #log_state, and
+ * each one has its own time series saved alongside it, named with a `_time`
+ * suffix. Aggregators with a `change_tolerance` are event-driven: a row (and
+ * its time) is only appended when the value has changed since the last saved
+ * row, so they also get their own time series:
+ *
+ * ```
+ * logFile.h5
+ * |__ trial_1  (group)
+ * |   |__ time (dataset)  [1 x t]
+ * |   |__ aggregator_1 (dataset)  [n x t]
+ * |   |__ slow_aggregator (dataset)  [k x s]
+ * |   |__ slow_aggregator_time (dataset)  [1 x s]
+ * |   |__ ...
+ * ```
+ *
+ * Full trajectories of every robot can be saved compactly with
+ * #add_trajectory, which stores quantized poses and colors (about 1/5 of the
+ * size of saving them as doubles with aggregators).
+ *
+ * For tools that only need raw frames, #add_frame_stream saves every Robot's
+ * state to a memory-mapped binary file instead of the HDF5 file, which
+ * avoids HDF5's overhead on every frame.
+ *
  * Logging (I/O in general) is one of the *slowest* parts of the simulation. As
  * such, a high logging rate will significantly slow down your simulations. Try
  * something like logging every 5-10 seconds, if you can get away with it.
@@ -97,6 +147,22 @@ public:
    */
   typedef std::vector<double> (*aggregatorFunc)(std::vector<Robot *> &robots);
 
+  /*!
+   * A callable mapping Robots to values, written into a preallocated row
+   *
+   * This is the allocation-free counterpart of #aggregatorFunc. Instead of
+   * returning a new vector every time it is called, it writes exactly
+   * `out_len` values into `out`, which is a buffer owned by the Logger and
+   * reused on every call to #log_state. The length is fixed when the
+   * aggregator is added with #add_aggregator.
+   *
+   * Because this is a `std::function`, lambdas with captured state (and other
+   * function objects) can be used, as well as plain functions.
+   */
+  typedef std::function<void(std::vector<Robot *> &robots, double *out,
+                             const size_t out_len)>
+      spanAggregatorFunc;
+
 private:
   //! Managed H5File pointer
   typedef std::shared_ptr<H5::H5File> H5FilePtr;
@@ -105,6 +171,48 @@ private:
   //! Managed pointer to HDF5 PacketTable
   typedef std::shared_ptr<FL_PacketTable> H5PacketTablePtr;
   typedef std::unordered_map<std::string, double> Params;
+  //! An aggregator, its reusable output row, and the dataset it appends to
+  struct Aggregator
+  {
+    //! Function that fills the output row from the Robots
+    spanAggregatorFunc func;
+    //! Preallocated output row (its size is fixed by add_aggregator)
+    std::vector<double> row;
+    //! HDF5 dataset (PacketTable) in the current trial
+    H5PacketTablePtr dset;
+    //! Ticks between logging this aggregator (0 = logged by log_state)
+    uint32_t period_ticks;
+    //! Next tick at which this aggregator is due to be logged by log_due
+    uint32_t next_tick;
+    //! Own time series, for periodic or change-triggered aggregators
+    H5PacketTablePtr time_dset;
+    //! Minimum change to append a row (negative = append on every log)
+    double change_tolerance;
+    //! Last row that was appended (only used with a change_tolerance)
+    std::vector<double> last_row;
+    //! Whether last_row holds a row appended in the current trial
+    bool has_last_row;
+  };
+  //! A quantized trajectory of all Robots, and the datasets it appends to
+  struct Trajectory
+  {
+    //! Size of one position count, in mm
+    double position_resolution;
+    //! Whether frames are saved as differences from the previous frame
+    bool delta_encode;
+    //! Ticks between frames (0 = logged by log_state)
+    uint32_t period_ticks;
+    //! Next tick at which this trajectory is due to be logged by log_due
+    uint32_t next_tick;
+    //! Preallocated frame being encoded
+    std::vector<QuantizedPose> frame;
+    //! Previous (not delta-encoded) frame, for delta encoding
+    std::vector<QuantizedPose> prev_frame;
+    //! HDF5 dataset (PacketTable) of frames in the current trial
+    H5PacketTablePtr dset;
+    //! Time series of the frames
+    H5PacketTablePtr time_dset;
+  };
   //! Reference to Kilosim World that this Logger tracks
   World &m_world;
   //! HDF5 file where the data lives
@@ -113,10 +221,10 @@ private:
   bool m_overwrite_trials;
   //! Trial number specifying group where the data lives
   uint m_trial_num;
-  //! Names and functions of aggregators
-  std::unordered_map<std::string, aggregatorFunc> m_aggregators;
-  //! Names and HDF5 datasets (PacketTables) for every aggregator
-  std::unordered_map<std::string, H5PacketTablePtr> m_aggregator_dsets;
+  //! Names, functions, output buffers, and datasets of aggregators
+  std::unordered_map<std::string, Aggregator> m_aggregators;
+  //! Names and state of quantized trajectories
+  std::unordered_map<std::string, Trajectory> m_trajectories;
   //! Opened HDF5 file where this Logger saves
   H5FilePtr m_h5_file;
   //! HDF5 group name for trial. e.g., /trial_0
@@ -129,6 +237,12 @@ private:
   std::string m_time_dset_name;
   //! HDF5 PacketTable used to track the time (in seconds) when logging state
   H5PacketTablePtr m_time_table;
+  //! Binary frame stream saved alongside the HDF5 file (if added)
+  std::unique_ptr<FrameStreamWriter> m_frame_stream;
+  //! Ticks between frame stream frames (0 = logged by log_state)
+  uint32_t m_frame_stream_period_ticks = 0;
+  //! Next tick at which the frame stream is due to be logged by log_due
+  uint32_t m_frame_stream_next_tick = 0;
   //! Conversion from JSON types to HDF5 types (NOTE: only works for atomic datatypes)
   std::unordered_map<json::value_t, H5::PredType> m_json_h5_types = {
       {json::value_t::boolean, H5::PredType::NATIVE_HBOOL},
@@ -170,6 +284,9 @@ public:
    *
    * The same overwrite_trials flag from initialization is still in effect
    *
+   * Datasets for all of the aggregators that have already been added are
+   * created in the new trial's group.
+   *
    * @param trial_num New trial you want to log.
    */
   void set_trial(uint const trial_num);
@@ -190,15 +307,151 @@ public:
    * agg_func. This exists within the trial_# group.
    * @param agg_func Aggregator that saves values from the Robots in the World.
    * Each output is saved as a row in the dataset.
+   * @param log_period How often (in simulated seconds) to log this aggregator.
+   * If 0 (default), it is logged on every call to #log_state and shares the
+   * trial's `time` series. Otherwise it is logged by #log_due whenever this
+   * much time has passed, with its own `<agg_name>_time` series.
+   * @param change_tolerance If negative (default), a row is appended every
+   * time the aggregator is logged. Otherwise, the aggregator is only saved
+   * (with its time, in its own `<agg_name>_time` series) when any value
+   * differs from the last saved row by more than this. The first value in a
+   * trial is always saved. Use 0 to save on any change. This is useful for
+   * values that stay constant for long stretches, like a consensus state.
+   *
+   * Throws a `std::runtime_error` if an aggregator or trajectory named
+   * `agg_name` was already added.
    */
-  void add_aggregator(std::string const agg_name, aggregatorFunc const agg_func);
+  void add_aggregator(std::string const agg_name, aggregatorFunc const agg_func,
+                      const double log_period = 0,
+                      const double change_tolerance = -1);
+
+  /*!
+   * Add an allocation-free aggregator that writes into a preallocated row.
+   *
+   * This behaves like the #aggregatorFunc version, except the output length
+   * must be given up front (rather than determined by a test call), and the
+   * Logger allocates the output row once here. Every later call to #log_state
+   * reuses that row, so logging does not allocate.
+   *
+   * ```
+   * double threshold = 500;
+   * logger.add_aggregator("num_bright", 1,
+   *     [threshold](std::vector<Robot *> &robots, double *out, size_t) {
+   *       out[0] = 0;
+   *       for (auto &r : robots)
+   *         out[0] += ((MyKilobot *)r)->light_intensity > threshold;
+   *     });
+   * ```
+   *
+   * @param agg_name Name of the dataset in with to store the output of the
+   * agg_func. This exists within the trial_# group.
+   * @param out_len Number of values agg_func writes on every call
+   * @param agg_func Callable that writes `out_len` values from the Robots in
+   * the World into the given row. Each row is saved in the dataset.
+   * @param log_period How often (in simulated seconds) to log this aggregator.
+   * See the #aggregatorFunc version.
+   * @param change_tolerance Only save rows that changed by more than this
+   * (negative to save every row). See the #aggregatorFunc version.
+   *
+   * Throws a `std::runtime_error` if `agg_name` is already in use.
+   */
+  void add_aggregator(std::string const agg_name, const size_t out_len,
+                      spanAggregatorFunc const agg_func,
+                      const double log_period = 0,
+                      const double change_tolerance = -1);
 
   /*!
    * Log the aggregators at the given time mapped over all the given robots in
    * the World. Every time this is called, the current time (in seconds) is
    * added to the time series, and a row is appended to every aggregator array.
+   *
+   * Aggregators with their own `log_period` are not logged here; use
+   * #log_due for those.
+   */
+  void log_state();
+
+  /*!
+   * Log every aggregator with its own `log_period` that is due at the
+   * World's current tick.
+   *
+   * Call this after every `World::step()`. Each aggregator is logged at the
+   * first call, and then whenever the World's time reaches the next multiple
+   * of its period. The time is appended to that aggregator's own time series.
+   * Aggregators that are not due cost only a comparison.
+   *
+   * Trajectories with their own `log_period` are logged here in the same way.
+   */
+  void log_due();
+
+  /*!
+   * Save the pose and color of every Robot as a compact, quantized trajectory.
+   *
+   * Each frame is saved as a row of #QuantizedPose (10 bytes per Robot,
+   * instead of 48 bytes for x, y, theta, and color as doubles):
+   *
+   * - `x` and `y` as 16-bit counts of `position_resolution` mm
+   * - `theta` as 16-bit fractions of a full turn
+   * - `color` as three 8-bit components
+   *
+   * The frames are saved in a dataset named `traj_name` (`[n x t]`, for `n`
+   * Robots), with the times of the frames in `<traj_name>_time`. The
+   * dataset has the attributes `position_resolution`, `theta_resolution`,
+   * `color_resolution`, and `delta_encoded` needed to decode it. With h5py:
+   *
+   * ```
+   * traj = f['trial_1/traj']
+   * frames = traj[...]  # [t x n], with fields x, y, theta, and color
+   * x = frames['x']
+   * if traj.attrs['delta_encoded']:
+   *     x = np.cumsum(x, axis=0, dtype=np.uint16)  # Wraps like the encoder
+   * x = x * traj.attrs['position_resolution']  # mm
+   * ```
+   *
+   * `decode_h5_trajectory.py` in the repository does this for you.
+   *
+   * If `delta_encode` is set, each frame is instead saved as the difference
+   * from the previous frame (wrapping around on overflow; the first frame of
+   * a trial is stored as-is), and the dataset is compressed. Robots move only
+   * a few counts per frame, so this compresses well when logging frequently.
+   *
+   * @param traj_name Name of the frame dataset within the trial_# group
+   * @param position_resolution Size (in mm) of one position count. The
+   * largest World dimension must fit in 65535 counts (e.g., 0.1 mm allows up
+   * to 6.5 m arenas).
+   * @param log_period How often (in simulated seconds) to save a frame. If 0
+   * (default), a frame is saved on every call to #log_state; otherwise
+   * frames are saved by #log_due.
+   * @param delta_encode Whether to save frames as differences from the
+   * previous frame (and compress them)
+   */
+  void add_trajectory(const std::string traj_name,
+                      const double position_resolution = 0.1,
+                      const double log_period = 0,
+                      const bool delta_encode = false);
+
+  /*!
+   * Also save the state of every Robot to a binary frame stream file (see
+   * FrameStreamWriter), rather than to the HDF5 file.
+   *
+   * Each frame is the time and the raw x, y, theta, and color of every Robot,
+   * appended to a memory-mapped file. This is much cheaper per frame than
+   * the HDF5 datasets, and the file can be read without copying with a
+   * FrameStreamReader or converted to this Logger's HDF5 layout later with
+   * `frame_stream_to_h5`.
+   *
+   * A Logger has at most one frame stream, and it isn't tied to the trial:
+   * calling this again (e.g., after #set_trial) closes the previous stream
+   * and starts a new file. The number of Robots in each frame is fixed to
+   * the number in the World when this is called.
+   *
+   * @param filename Name/location of the binary file to create (or
+   * overwrite)
+   * @param log_period How often (in simulated seconds) to save a frame. If 0
+   * (default), a frame is saved on every call to #log_state; otherwise
+   * frames are saved by #log_due.
    */
-  void log_state() const;
+  void add_frame_stream(const std::string filename,
+                        const double log_period = 0);
 
   /*!
    * Log all of the values in the configuration as params in the HDF5 file/trial
@@ -234,7 +487,23 @@ public:
 
 private:
   //! Log data for this specific aggregator
-  void log_aggregator(const std::string agg_name, const aggregatorFunc agg_func) const;
+  void log_aggregator(Aggregator &agg);
+  //! Throw if an aggregator can't be added with this name
+  void check_aggregator_name(const std::string &agg_name) const;
+  //! Create the PacketTable for an aggregator in the current trial group
+  H5PacketTablePtr create_aggregator_dset(const std::string &agg_name,
+                                          const size_t out_len);
+  //! Create a PacketTable for a time series in the current trial group
+  H5PacketTablePtr create_time_dset(const std::string &dset_name);
+  //! Append the World's current time to the given time series
+  void log_time(const H5PacketTablePtr &time_dset) const;
+  //! Convert a tick period in seconds to ticks (0 if not periodic)
+  uint32_t period_to_ticks(const double log_period) const;
+  //! Quantize (and possibly delta encode) the Robots and save a frame
+  void log_trajectory(Trajectory &traj);
+  //! Create the frame dataset (with decoding attributes) for a trajectory
+  H5PacketTablePtr create_trajectory_dset(const std::string &traj_name,
+                                          const Trajectory &traj);
   //! Get the H5 data type (for saving) from the JSON
   H5::PredType h5_type(const json j) const;
   //! Create or open an HDF5 file
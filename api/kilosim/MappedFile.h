@@ -0,0 +1,84 @@
+/*
+  Kilosim
+
+  Memory-mapped files, used for streaming binary logs
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_MAPPEDFILE_H
+#define __KILOSIM_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Kilosim
+{
+/*!
+ * A file mapped into memory (with POSIX `mmap`), so it can be read or written
+ * through a pointer without copying through I/O buffers.
+ *
+ * A read-only MappedFile maps the whole file as it is when opened. A writable
+ * MappedFile can be grown or shrunk with #resize, which changes the file's
+ * size on disk and remaps it. (This invalidates any pointers into the old
+ * mapping.)
+ *
+ * Errors opening, resizing, or mapping the file throw a `std::runtime_error`.
+ */
+class MappedFile
+{
+private:
+  //! Name/location of the mapped file
+  std::string m_filename;
+  //! File descriptor of the open file
+  int m_fd = -1;
+  //! Start of the mapping (nullptr if the file is empty)
+  char *m_data = nullptr;
+  //! Size of the file (and mapping) in bytes
+  size_t m_size = 0;
+  //! Whether the file was opened for writing
+  bool m_writable;
+
+public:
+  /*!
+   * Open and map a file
+   *
+   * @param filename Name/location of the file
+   * @param writable If true, the file is created (or truncated to empty) and
+   * opened for writing. If false, an existing file is mapped read-only.
+   */
+  MappedFile(const std::string &filename, const bool writable);
+  //! Unmap and close the file
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /*!
+   * Change the size of a writable file and remap it
+   * @param new_size New size of the file in bytes
+   */
+  void resize(const size_t new_size);
+
+  /*!
+   * Ask the OS to start writing modified pages back to the file, without
+   * waiting for it to finish
+   */
+  void flush_async();
+
+  //! @return Start of the mapped file contents
+  char *data() { return m_data; }
+  //! @return Start of the mapped file contents
+  const char *data() const { return m_data; }
+  //! @return Size of the mapped file in bytes
+  size_t size() const { return m_size; }
+
+private:
+  //! Map the current m_size bytes of the file
+  void map();
+  //! Unmap the file (if mapped)
+  void unmap();
+};
+} // namespace Kilosim
+
+#endif
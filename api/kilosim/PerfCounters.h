@@ -0,0 +1,91 @@
+/*
+  Kilosim
+
+  Hardware performance counters (Linux perf_event_open) for profiling
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_PERFCOUNTERS_H
+#define __KILOSIM_PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+
+namespace Kilosim
+{
+//! Hardware events counted by PerfCounters
+enum PerfCounter
+{
+  //! CPU cycles
+  PERF_CYCLES,
+  //! Instructions retired
+  PERF_INSTRUCTIONS,
+  //! Last-level cache misses
+  PERF_CACHE_MISSES,
+  //! Mispredicted branches
+  PERF_BRANCH_MISSES,
+  NUM_PERF_COUNTERS
+};
+
+//! Count of each PerfCounter event (indexed by PerfCounter)
+typedef std::array<uint64_t, NUM_PERF_COUNTERS> PerfCounts;
+
+/*!
+ * PerfCounters counts hardware events (cycles, instructions, cache misses,
+ * and branch misses) on the calling thread, in user space, with Linux
+ * `perf_event_open`. Read the counts before and after some code to see
+ * whether it's compute-bound (many instructions per cycle) or stalled on
+ * memory (many cache misses).
+ *
+ * Counters aren't always available: other OSes, virtual machines without a
+ * PMU, and `kernel.perf_event_paranoid` settings can prevent some or all of
+ * them from being opened. This never fails; use #is_available and
+ * #has_counter to check what's counted. Unavailable counts are 0.
+ *
+ * The counters are opened as a group, so they're all read with a single
+ * system call and always cover the same interval. If the CPU has to
+ * multiplex them with other users of the counters, counts are scaled up to
+ * estimate the full interval.
+ */
+class PerfCounters
+{
+private:
+  //! File descriptor of each counter (-1 if unavailable). The first one
+  //! opened leads the group.
+  std::array<int, NUM_PERF_COUNTERS> m_fds;
+  //! Position of each counter in a group read (-1 if unavailable)
+  std::array<int, NUM_PERF_COUNTERS> m_read_index;
+  //! Number of counters opened
+  int m_num_open = 0;
+  //! File descriptor of the group leader (-1 if none are available)
+  int m_leader = -1;
+
+public:
+  //! Open and start all available counters for the calling thread
+  PerfCounters();
+  //! Close the counters
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  //! @return Whether any counters are available
+  bool is_available() const;
+
+  //! @return Whether a counter is available
+  bool has_counter(const PerfCounter counter) const;
+
+  /*!
+   * Read the total count of each event since the counters were opened
+   * @param counts Filled with the counts (0 for unavailable counters)
+   * @return Whether the counters could be read
+   */
+  bool read(PerfCounts &counts) const noexcept;
+
+  //! @return Short name of a counter (e.g., "cache_misses")
+  static const char *get_name(const PerfCounter counter);
+};
+} // namespace Kilosim
+
+#endif
@@ -17,8 +17,10 @@
 #define omp_get_thread_num() 0
 #define omp_get_num_threads() 1
 #define omp_get_max_threads() 1
+#define omp_in_parallel() 0
 #endif
 
+#include <iostream>
 #include <random>
 
 typedef std::mt19937 our_random_engine;
@@ -41,6 +43,20 @@ double uniform_rand_real(double from, double thru);
 //deviation. Thread-safe
 double normal_rand(double mean, double stddev);
 
+//Writes the state of every thread's PRNG engine (and the distributions used
+//above) to a stream, so it can be restored exactly by load_rand_state
+void save_rand_state(std::ostream &out);
+
+//Restores the PRNG state written by save_rand_state. Throws a
+//std::runtime_error if the state can't be read
+void load_rand_state(std::istream &in);
+
+//Like save_rand_state, but only for the calling thread's engine
+void save_thread_rand_state(std::ostream &out);
+
+//Like load_rand_state, but only for the calling thread's engine
+void load_thread_rand_state(std::istream &in);
+
 template <class T>
 T uniform_bits()
 {
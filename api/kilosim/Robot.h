@@ -7,6 +7,8 @@
 
 #include <iostream>
 #include <cmath>
+#include <istream>
+#include <ostream>
 
 constexpr double motion_error_std = .02;
 constexpr double PI = 3.14159265358979324;
@@ -107,6 +109,9 @@ protected:
 	double battery = -1;
 	//! Flag set to 1 when robot wants to transmit
 	int tx_request;
+	//! Light sensor reading at the current pose (set by the World once per
+	//! tick), or -1 if it must be computed. Reset whenever the robot moves.
+	int16_t m_light_reading = -1;
 
 public:
 	//! UUID of the robot, set in robot_init()
@@ -178,6 +183,29 @@ public:
 	 */
 	void add_to_world(LightPattern &light_pattern, const double dt);
 
+	/*!
+	 * Get the position of the Robot's light sensor (at the front of the
+	 * robot), truncated to whole mm
+	 * @param sensor_x x-position of the sensor
+	 * @param sensor_y y-position of the sensor
+	 */
+	void light_sensor_position(int &sensor_x, int &sensor_y) const
+	{
+		sensor_x = x + RADIUS * 1 * cos(theta);
+		sensor_y = y + RADIUS * 1 * sin(theta);
+	}
+
+	/*!
+	 * Set the light sensor reading for the Robot's current pose, so it isn't
+	 * looked up again when the controller reads the sensor. This is called
+	 * by the World every tick with readings for all robots at once.
+	 * @param reading 10-bit light intensity at the light sensor
+	 */
+	void set_light_reading(const uint16_t reading)
+	{
+		m_light_reading = reading;
+	}
+
 	// TODO: Not sure what use this timer is useful for?
 	//! Robot's internal timer
 	int timer;
@@ -209,6 +237,40 @@ public:
 
 	virtual char *get_debug_info(char *buffer, char *rt) = 0;
 
+	/*!
+	 * Write the complete state of the Robot to a checkpoint. This includes the
+	 * pose, color, and the simulated physical state (e.g., motor error,
+	 * collision timers, and battery), followed by any state of the specific
+	 * implementation (see `save_robot_state()`).
+	 *
+	 * This is called by `World::save_checkpoint()` for every Robot.
+	 *
+	 * @param out Stream to write the state to
+	 */
+	void save_checkpoint(std::ostream &out) const;
+
+	/*!
+	 * Create a copy of this Robot (of the same type, with the same state) on
+	 * the heap. This is used by `World::clone()`.
+	 *
+	 * Robot types that can be cloned must implement this, which is usually
+	 * just `Robot *clone() const { return new MyKilobot(*this); }`. By
+	 * default, it throws a `std::runtime_error`.
+	 *
+	 * @return New copy of the Robot, owned by the caller
+	 */
+	virtual Robot *clone() const;
+
+	/*!
+	 * Restore the state written by `save_checkpoint()`.
+	 *
+	 * This is called by `World::load_checkpoint()` for every Robot. It does
+	 * not change which World the Robot belongs to.
+	 *
+	 * @param in Stream to read the state from
+	 */
+	void load_checkpoint(std::istream &in);
+
 	/*!
 	 * Determine if another robot is within communication range
 	 * This is called by a transmitting (tx) robot to verify if the receiver is
@@ -270,6 +332,19 @@ protected:
 
 	//! Wrap an angle to be within [0, 2*pi)
 	double wrap_angle(double angle) const;
+
+	/*!
+	 * Write any state of the specific Robot implementation to a checkpoint.
+	 * It is called by `save_checkpoint()` after the Robot's own state. By
+	 * default, nothing is saved.
+	 */
+	virtual void save_robot_state(std::ostream &) const {}
+
+	/*!
+	 * Restore the state written by `save_robot_state()`. It is called by
+	 * `load_checkpoint()`.
+	 */
+	virtual void load_robot_state(std::istream &) {}
 };
 } // namespace Kilosim
 #endif
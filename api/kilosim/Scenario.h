@@ -0,0 +1,168 @@
+/*
+  Kilosim
+
+  Initial placement, types, and parameters of every robot, loaded from JSON
+  (streamed) or HDF5 files
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_SCENARIO_H
+#define __KILOSIM_SCENARIO_H
+
+#include <kilosim/Robot.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Kilosim
+{
+/*!
+ * A Scenario holds the initial state of every robot in a simulation: its
+ * pose, its type, and any numeric per-robot parameters. Values are stored as
+ * one array per field (rather than one object per robot), so scenarios with
+ * 100,000s of robots load quickly and take little memory.
+ *
+ * Load a scenario with #load_scenario, then initialize robots with
+ * #init_robots and read any per-robot parameters with #get_param.
+ *
+ * JSON scenario files are parsed as a stream, straight into the arrays,
+ * without building a JSON tree of the whole file:
+ *
+ * ```
+ * {
+ *   "robots": [
+ *     {"x": 75, "y": 75, "theta": 0, "type": "leader", "speed": 1.5},
+ *     {"x": 175, "y": 75, "theta": 1.57},
+ *     ...
+ *   ]
+ * }
+ * ```
+ *
+ * Each robot needs an `"x"` and `"y"` (mm). `"theta"` (radians) defaults to
+ * 0, and `"type"` (a name or an integer) defaults to 0. Any other numeric
+ * value is a per-robot parameter, which is NaN for robots that don't set it.
+ * Other top-level keys are ignored, so a scenario can be part of a config
+ * file.
+ *
+ * HDF5 scenario files hold the same data as 1D datasets of the same length
+ * in one group: `x`, `y`, and optionally `theta`, `type` (integers), and any
+ * parameters. If the `type` dataset has a `type_names` string attribute, the
+ * types are indices into it; otherwise types are named by their number. Use
+ * #save_scenario to convert a JSON scenario to HDF5.
+ */
+class Scenario
+{
+public:
+  //! x positions (mm from the left)
+  std::vector<double> x;
+  //! y positions (mm from the bottom)
+  std::vector<double> y;
+  //! Orientations (radians)
+  std::vector<double> theta;
+  //! Index (in #type_names) of each robot's type
+  std::vector<uint16_t> type;
+  //! Names of the types of robot (integer types are named by their number)
+  std::vector<std::string> type_names;
+  //! Names of the per-robot parameters
+  std::vector<std::string> param_names;
+  //! Values of each parameter (in the order of #param_names) for every robot
+  std::vector<std::vector<double>> params;
+
+  //! @return Number of robots in the scenario
+  size_t size() const;
+
+  /*!
+   * Get the index of a type of robot
+   * @param type_name Name of the type
+   * @return Index of the type (as in #type), or -1 if no robot has the type
+   */
+  int get_type_index(const std::string &type_name) const;
+
+  /*!
+   * Get the values of a per-robot parameter. Throws a `std::runtime_error`
+   * if the scenario doesn't have the parameter.
+   * @param name Name of the parameter
+   * @return Value for every robot (NaN for robots without a value)
+   */
+  const std::vector<double> &get_param(const std::string &name) const;
+
+  /*!
+   * Check whether the scenario has a per-robot parameter
+   * @param name Name of the parameter
+   * @return Whether any robot has a value for the parameter
+   */
+  bool has_param(const std::string &name) const;
+
+  /*!
+   * Initialize robots at their poses in the scenario (with
+   * Robot::robot_init). Throws a `std::runtime_error` if the number of
+   * robots doesn't match the scenario.
+   * @param robots Robots to initialize, in the order of the scenario
+   */
+  void init_robots(const std::vector<Robot *> &robots) const;
+
+  /*!
+   * Add a robot to the end of the scenario
+   * @return Index of the robot
+   */
+  size_t add_robot(const double x, const double y, const double theta,
+                   const uint16_t type = 0);
+
+  /*!
+   * Get the index of a type name, adding it if it's new
+   * @param type_name Name of the type
+   * @return Index of the type (as in #type)
+   */
+  uint16_t add_type(const std::string &type_name);
+
+  /*!
+   * Get the index of a parameter, adding it (NaN for every robot) if it's new
+   * @param name Name of the parameter
+   * @return Index of the parameter (in #param_names and #params)
+   */
+  size_t add_param(const std::string &name);
+};
+
+/*!
+ * Load a scenario from a file. Files ending in `.h5` or `.hdf5` are read as
+ * HDF5; anything else is parsed as JSON. Throws a `std::runtime_error` if
+ * the file can't be read or isn't a valid scenario.
+ * @param filename Name/location of the scenario file
+ * @param group For HDF5 files, the group containing the datasets
+ * @return Loaded scenario
+ */
+Scenario load_scenario(const std::string filename,
+                       const std::string group = "/");
+
+/*!
+ * Load a scenario from a JSON file, parsing it as a stream (see Scenario for
+ * the format). Throws a `std::runtime_error` if it isn't a valid scenario.
+ * @param filename Name/location of the JSON file
+ * @return Loaded scenario
+ */
+Scenario load_scenario_json(const std::string filename);
+
+/*!
+ * Load a scenario from an HDF5 file (see Scenario for the layout). Throws a
+ * `std::runtime_error` if it isn't a valid scenario.
+ * @param filename Name/location of the HDF5 file
+ * @param group Group containing the datasets
+ * @return Loaded scenario
+ */
+Scenario load_scenario_hdf5(const std::string filename,
+                            const std::string group = "/");
+
+/*!
+ * Save a scenario to an HDF5 file (overwriting it), e.g. to convert a large
+ * JSON scenario once so later runs load faster. Type names are saved in a
+ * `type_names` attribute of the `type` dataset, so they are restored when the
+ * file is loaded.
+ * @param scenario Scenario to save
+ * @param filename Name/location of the HDF5 file
+ */
+void save_scenario(const Scenario &scenario, const std::string filename);
+} // namespace Kilosim
+
+#endif
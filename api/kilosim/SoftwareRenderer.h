@@ -0,0 +1,150 @@
+/*
+  Kilosim
+
+  CPU-only renderer of a World into an in-memory image, for saving frames
+  and videos without a display or OpenGL
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_SOFTWARERENDERER_H
+#define __KILOSIM_SOFTWARERENDERER_H
+
+#include <kilosim/World.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Kilosim
+{
+/*!
+ * The SoftwareRenderer draws a World the same way as the Viewer (the light
+ * pattern as background, and each robot as a disk in its LED color with a
+ * black line showing its heading), but entirely on the CPU into an RGB
+ * buffer. It doesn't need a window, display, or OpenGL, so it can be used on
+ * headless machines (e.g., cluster nodes) to save images or videos.
+ *
+ * Rendering is parallelized with OpenMP over horizontal bands of the image,
+ * so rendering every N ticks adds little to the simulation time.
+ *
+ * ```
+ * Kilosim::SoftwareRenderer renderer(world, 720);
+ * renderer.start_video("trial.y4m");
+ * while (world.get_time() < trial_duration)
+ * {
+ *   world.step();
+ *   if (world.get_tick() % 32 == 0)
+ *   {
+ *     renderer.draw();
+ *     renderer.add_video_frame();
+ *   }
+ * }
+ * ```
+ *
+ * Videos are saved as uncompressed [YUV4MPEG2](https://wiki.multimedia.cx/index.php/YUV4MPEG2)
+ * (`.y4m`) streams, which can be played or compressed with tools like ffmpeg
+ * (e.g., `ffmpeg -i trial.y4m trial.mp4`).
+ */
+class SoftwareRenderer
+{
+private:
+  //! Reference to the World that this renderer draws
+  World &m_world;
+  //! Width of the image (in pixels)
+  const int m_width;
+  //! Height of the image (in pixels)
+  int m_height;
+  //! Scaling ratio between world and image coordinates
+  double m_scale;
+  //! Light pattern scaled to the image size (RGB, top row first)
+  std::vector<uint8_t> m_background;
+  //! Version of the World's light pattern in m_background
+  uint32_t m_bg_version;
+  //! Rendered image (RGB, top row first)
+  std::vector<uint8_t> m_pixels;
+  //! For each band of rows, the indices of the robots that overlap it
+  std::vector<std::vector<uint32_t>> m_band_robots;
+  //! Open video stream (if any)
+  std::ofstream m_video;
+  //! Reused buffer for converting frames to Y'CbCr for the video stream
+  std::vector<uint8_t> m_video_frame;
+
+public:
+  /*!
+   * Create a renderer for a World
+   *
+   * @param world World that will be drawn
+   * @param image_width Width (in pixels) of the rendered image. Height will
+   * be automatically determined from the aspect ratio of the World's
+   * dimensions.
+   */
+  SoftwareRenderer(World &world, const int image_width = 1080);
+  //! Close the video (if any)
+  ~SoftwareRenderer();
+
+  /*!
+   * Render the current state of the World into the image buffer
+   */
+  void draw();
+
+  /*!
+   * Get the rendered image
+   * @return RGB pixel values (3 bytes per pixel), row by row from the top
+   */
+  const std::vector<uint8_t> &get_pixels() const;
+
+  //! @return Width of the rendered image in pixels
+  int get_width() const;
+  //! @return Height of the rendered image in pixels
+  int get_height() const;
+
+  /*!
+   * Save the rendered image as a binary PPM file
+   * @param filename Name/location of the file to write
+   * @return Whether the file was written successfully
+   */
+  bool save_ppm(const std::string filename) const;
+
+  /*!
+   * Save the rendered image to an image file (such as PNG). The format is
+   * determined by the extension, and must be supported by SFML's
+   * [Image::saveToFile](https://www.sfml-dev.org/documentation/2.5.1/classsf_1_1Image.php#a51537fb667f47cbe80395cfd7f9e72a4)
+   * (This does not use OpenGL.)
+   * @param filename Name/location of the file to write
+   * @return Whether the file was written successfully
+   */
+  bool save_image(const std::string filename) const;
+
+  /*!
+   * Start saving frames to an uncompressed YUV4MPEG2 video file. Any video
+   * that was already started is closed.
+   * @param filename Name/location of the video file to write
+   * @param frame_rate Frames per second of playback
+   * @return Whether the file was opened successfully
+   */
+  bool start_video(const std::string filename, const int frame_rate = 30);
+
+  /*!
+   * Append the rendered image as a frame of the video started with
+   * #start_video. Call #draw first to update the image.
+   */
+  void add_video_frame();
+
+  /*!
+   * Finish and close the current video (if any). This is done automatically
+   * when the renderer is destroyed.
+   */
+  void stop_video();
+
+private:
+  //! Scale the World's light pattern to the image size
+  void render_background();
+  //! Draw a robot, clipped to rows [row_start, row_end)
+  void draw_robot(const Robot &robot, const int row_start, const int row_end);
+};
+
+} // namespace Kilosim
+
+#endif
@@ -0,0 +1,147 @@
+/*
+  Kilosim
+
+  Periodic live telemetry (progress and speed) of a running simulation
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_TELEMETRY_H
+#define __KILOSIM_TELEMETRY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Kilosim
+{
+//! Snapshot of a World's progress, published by Telemetry
+struct TelemetrySample
+{
+  //! When the sample was taken
+  std::chrono::steady_clock::time_point wall_time;
+  //! Current tick
+  uint32_t tick;
+  //! Current simulated time (seconds)
+  double time;
+  //! Number of robots in the World
+  uint64_t num_robots;
+  //! Total messages delivered (one per receiving robot)
+  uint64_t messages_delivered;
+  //! Total robot-ticks spent colliding with another robot
+  uint64_t robot_collisions;
+  //! Total robot-ticks spent colliding with a wall
+  uint64_t wall_collisions;
+  //! Total time (seconds) in each phase of a step (see World::get_phase_times)
+  std::vector<std::pair<std::string, double>> phase_times;
+};
+
+/*!
+ * Telemetry publishes a JSON snapshot of a running simulation every few
+ * (wall clock) seconds, so long runs can be monitored without attaching a
+ * debugger. Use it through World::enable_telemetry.
+ *
+ * Each snapshot has the tick and simulated time, ticks per second since the
+ * previous snapshot, the number of robots, total messages delivered and
+ * collisions, and the total and per-tick time of each phase of a step. It can
+ * be published to either or both of:
+ *
+ * - A JSON file, which is replaced atomically (written to `<file>.tmp`, then
+ *   renamed), so readers always see a complete snapshot. e.g.,
+ *   `watch cat telemetry.json`
+ * - A UNIX datagram socket, with one snapshot per datagram. Nothing is sent
+ *   (and nothing fails) if no one is listening. e.g.,
+ *   `socat UNIX-RECVFROM:/tmp/kilosim.sock,fork -`
+ *
+ * Publishing never slows down a step: the stepping thread only copies a few
+ * numbers when a snapshot is due, and formatting and I/O happen on a
+ * background thread. If that thread falls behind (e.g., a slow disk), newer
+ * snapshots replace ones that haven't been written yet.
+ */
+class Telemetry
+{
+private:
+  //! File to write snapshots to (empty for none)
+  const std::string m_filename;
+  //! Socket address to send snapshots to (empty for none)
+  const std::string m_socket_path;
+  //! Minimum time between snapshots
+  const std::chrono::steady_clock::duration m_period;
+  //! Datagram socket (-1 if none)
+  int m_socket = -1;
+  //! When the next snapshot is due (only used by the stepping thread)
+  std::chrono::steady_clock::time_point m_next_due;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  //! Snapshot waiting to be written
+  TelemetrySample m_pending;
+  //! Whether m_pending hasn't been written yet
+  bool m_has_pending = false;
+  //! Tells the thread to stop (after writing any pending snapshot)
+  bool m_stop = false;
+  std::thread m_thread;
+
+  //! Previous snapshot written (only used by the background thread)
+  TelemetrySample m_last;
+  //! Whether the file has failed to be written (so it's only warned once)
+  bool m_file_failed = false;
+
+  //! Write snapshots as they're published, until stopped
+  void run();
+  //! Format a snapshot and write/send it
+  void write(const TelemetrySample &sample);
+
+public:
+  /*!
+   * Start publishing snapshots. Throws a `std::runtime_error` if the socket
+   * can't be created.
+   * @param filename JSON file to write snapshots to (empty for none)
+   * @param socket_path Path of the UNIX datagram socket to send snapshots to
+   * (empty for none)
+   * @param period Minimum wall clock time between snapshots (seconds)
+   * @param start Starting state, that the first snapshot's speed is measured
+   * from
+   */
+  Telemetry(const std::string filename, const std::string socket_path,
+            const double period, const TelemetrySample &start);
+  //! Write any pending snapshot and stop
+  ~Telemetry();
+
+  Telemetry(const Telemetry &) = delete;
+  Telemetry &operator=(const Telemetry &) = delete;
+
+  /*!
+   * Check whether a snapshot should be published (cheap enough to call every
+   * step)
+   * @param now Current time
+   */
+  bool is_due(const std::chrono::steady_clock::time_point now) const noexcept
+  {
+    return now >= m_next_due;
+  }
+
+  /*!
+   * Hand a snapshot to the background thread to be written. This never
+   * blocks; the snapshot is dropped if the thread is busy taking the
+   * previous one.
+   * @param sample Snapshot to publish (its contents are swapped out)
+   */
+  void publish(TelemetrySample &sample) noexcept;
+
+  /*!
+   * Hand a snapshot to the background thread to be written, waiting for the
+   * thread if it's busy, so the snapshot is never dropped (e.g., the final
+   * snapshot of a run)
+   * @param sample Snapshot to publish (its contents are swapped out)
+   */
+  void publish_blocking(TelemetrySample &sample);
+};
+} // namespace Kilosim
+
+#endif
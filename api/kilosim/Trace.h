@@ -0,0 +1,118 @@
+/*
+  Kilosim
+
+  Optional timeline tracing of simulation phases, exported as Chrome trace
+  JSON (for chrome://tracing or https://ui.perfetto.dev)
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_TRACE_H
+#define __KILOSIM_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/*!
+ * @file
+ * Tracing records when each phase of World::step, each Logger write, and each
+ * Viewer frame begins and ends, on every thread, so stalls show up on a
+ * timeline. It is only compiled in when `KILOSIM_TRACE` is defined (with the
+ * CMake option `-DKILOSIM_TRACE=ON`); otherwise the trace macros expand to
+ * nothing and cost nothing.
+ *
+ * Each thread records into its own fixed-size ring buffer, so only the most
+ * recent events (#set_trace_capacity per thread) are kept. Call
+ * #write_trace to save them, e.g. at the end of a trial:
+ *
+ * ```
+ * for (int t = 0; t < num_ticks; t++)
+ *   world.step();
+ * Kilosim::write_trace("kilosim-trace.json");
+ * ```
+ *
+ * Trace your own code by putting `KILOSIM_TRACE_SCOPE("name");` at the start
+ * of a block. Names must be string literals (or otherwise outlive the trace).
+ */
+
+#ifdef KILOSIM_TRACE
+#define KILOSIM_TRACE_CONCAT_(a, b) a##b
+#define KILOSIM_TRACE_CONCAT(a, b) KILOSIM_TRACE_CONCAT_(a, b)
+//! Record the rest of the enclosing block as an event
+#define KILOSIM_TRACE_SCOPE(name) \
+  ::Kilosim::TraceScope KILOSIM_TRACE_CONCAT(kilosim_trace_scope_, __LINE__)(name)
+//! Record an event between two std::chrono::steady_clock time points
+#define KILOSIM_TRACE_EVENT(name, begin, end) \
+  ::Kilosim::record_trace_event(name, begin, end)
+#else
+#define KILOSIM_TRACE_SCOPE(name) ((void)0)
+#define KILOSIM_TRACE_EVENT(name, begin, end) ((void)0)
+#endif
+
+namespace Kilosim
+{
+/*!
+ * Record an event on the calling thread (use the KILOSIM_TRACE_EVENT macro,
+ * so it's compiled out when tracing is disabled)
+ * @param name Name of the event (must outlive the trace)
+ * @param begin When the event began
+ * @param end When the event ended
+ */
+void record_trace_event(const char *name,
+                        const std::chrono::steady_clock::time_point begin,
+                        const std::chrono::steady_clock::time_point end) noexcept;
+
+/*!
+ * Records the lifetime of a block as a trace event (use the
+ * KILOSIM_TRACE_SCOPE macro, so it's compiled out when tracing is disabled)
+ */
+class TraceScope
+{
+private:
+  //! Name of the event
+  const char *m_name;
+  //! When the block began
+  std::chrono::steady_clock::time_point m_begin;
+
+public:
+  //! Start the event
+  TraceScope(const char *name) noexcept
+      : m_name(name), m_begin(std::chrono::steady_clock::now()) {}
+  //! End and record the event
+  ~TraceScope()
+  {
+    record_trace_event(m_name, m_begin, std::chrono::steady_clock::now());
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+};
+
+/*!
+ * Set how many events each thread keeps (older ones are overwritten). This
+ * only applies to threads that haven't recorded any events yet.
+ * @param events_per_thread Number of events (rounded up to a power of 2)
+ */
+void set_trace_capacity(const size_t events_per_thread);
+
+/*!
+ * Name the calling thread in the trace (e.g., "viewer"). Unnamed threads are
+ * numbered in the order they first record an event.
+ * @param name Name of the thread
+ */
+void set_trace_thread_name(const std::string name);
+
+/*!
+ * Save the events recorded on every thread as a Chrome trace JSON file.
+ * Throws a `std::runtime_error` if the file can't be written. If tracing is
+ * compiled out, the trace is empty.
+ * @param filename Name/location of the JSON file
+ */
+void write_trace(const std::string filename);
+
+//! Discard the events recorded so far on every thread
+void clear_trace();
+} // namespace Kilosim
+
+#endif
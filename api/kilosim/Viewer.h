@@ -15,7 +15,10 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace Kilosim
 {
@@ -24,6 +27,20 @@ namespace Kilosim
  * pointer to a World, which will be displayed whenever the #draw method is
  * called. After constructing your Viewer, this is the only method you need to
  * call to use it.
+ *
+ * By default, #draw renders and displays the frame immediately, so the
+ * simulation can't step faster than the display's frame rate. Alternatively,
+ * the Viewer can render on its own thread: #draw then only publishes a
+ * snapshot of the robots (when the render thread is ready for one), and the
+ * simulation keeps stepping at full speed. Frames are dropped, rather than
+ * blocking the simulation, whenever the render thread is busy.
+ *
+ * The view can be zoomed with the mouse wheel (or +/-) and panned by
+ * dragging with the left mouse button (or the arrow keys). Home resets the
+ * view to the whole World. Only robots in the visible region are drawn.
+ * When zoomed out far enough that robots would be tiny, the Viewer instead
+ * draws a heatmap of robot density, so the frame time stays roughly constant
+ * no matter how many robots there are.
  */
 class Viewer
 {
@@ -32,6 +49,32 @@ class Viewer
    * Example usage of a Viewer to display a World in a simulation loop.
    */
 
+public:
+  //! State of a single robot needed to draw it
+  struct RobotSnapshot
+  {
+    //! Position in the World (mm)
+    float x;
+    float y;
+    //! Rotation (radians)
+    float theta;
+    //! LED color
+    sf::Color color;
+  };
+  //! Copy of everything drawn in a frame, so it can be drawn while the World
+  //! keeps changing
+  struct Snapshot
+  {
+    //! World time (seconds)
+    double time;
+    //! State of every robot
+    std::vector<RobotSnapshot> robots;
+    //! Version of the World's light pattern in light_image
+    uint32_t light_version = 0;
+    //! Copy of the World's light pattern (only copied when it changes)
+    sf::Image light_image;
+  };
+
 private:
   //! Reference to the World that this Viewer draws
   World &m_world;
@@ -49,8 +92,60 @@ private:
   double m_scale;
   //! Texture used for drawing all the robots
   sf::RenderTexture m_robot_texture;
+  //! Textured quads (4 vertices per robot) drawn in a single draw call.
+  //! This is reused across frames, so it only reallocates when robots are added.
+  sf::VertexArray m_robot_vertices;
   //! Settings for SFML
   sf::ContextSettings m_settings;
+  //! Version of the light pattern loaded in m_bg_texture
+  uint32_t m_bg_version = 0;
+  //! Snapshot that is currently drawn
+  Snapshot m_snapshot;
+
+  //! Whether rendering is done on a separate thread
+  const bool m_threaded;
+  //! Thread that owns the window and renders snapshots (if m_threaded)
+  std::thread m_render_thread;
+  //! Tells the render thread to stop
+  std::atomic<bool> m_running;
+  //! Whether the render thread's window is still open
+  std::atomic<bool> m_window_open;
+  //! Whether the render thread is ready for a new snapshot
+  std::atomic<bool> m_snapshot_requested;
+  //! Protects m_published and m_snapshot_ready
+  std::mutex m_snapshot_mutex;
+  //! Newest snapshot published by #draw, not yet taken by the render thread
+  Snapshot m_published;
+  //! Whether m_published holds a snapshot the render thread hasn't taken
+  bool m_snapshot_ready = false;
+
+  //! Visible region of the World (in unzoomed window coordinates)
+  sf::View m_view;
+  //! Whether the view is being dragged with the mouse
+  bool m_dragging = false;
+  //! Last mouse position while dragging (pixels)
+  sf::Vector2i m_drag_pos;
+
+  //! Width/height (mm) of the cells of the grid used to find visible robots
+  double m_cell_size;
+  //! Number of columns in the grid
+  int m_grid_width;
+  //! Number of rows in the grid
+  int m_grid_height;
+  //! Index in m_cell_robots of the first robot in each cell (and the end)
+  std::vector<uint32_t> m_cell_start;
+  //! Indices of the robots in m_snapshot, sorted by cell
+  std::vector<uint32_t> m_cell_robots;
+  //! Whether the grid needs to be rebuilt for a new snapshot
+  bool m_grid_dirty = true;
+  //! Whether the density heatmap needs to be rebuilt for a new snapshot
+  bool m_density_dirty = true;
+  //! Robot density heatmap (one pixel per grid cell)
+  sf::Image m_density_image;
+  //! Texture of m_density_image
+  sf::Texture m_density_texture;
+  //! Rectangle covering the grid where the density heatmap is drawn
+  sf::RectangleShape m_density_shape;
 
 public:
   /*!
@@ -60,8 +155,13 @@ public:
    * @param window_width Width (in pixels) to draw the display window. Height
    * will be automatically determined from the aspect ratio of the World's
    * dimensions.
+   * @param render_thread Whether to render on a separate thread, so the
+   * frame rate doesn't limit the simulation speed
    */
-  Viewer(World &world, const int window_width = 1080);
+  Viewer(World &world, const int window_width = 1080,
+         const bool render_thread = false);
+  //! Stop the render thread (if any) and close the window
+  ~Viewer();
   /*!
    * Draw everything in the world at the current state
    *
@@ -69,14 +169,47 @@ public:
    * black). It is frame rate limited to 144 FPS, which limits the overall rate
    * at which the simulation can run. If the window is closed, the simulation
    * will continue to run but the window will not reopen.
+   *
+   * If the Viewer renders on its own thread, this instead publishes a
+   * snapshot of the World for the render thread and returns immediately. If
+   * the render thread hasn't taken the previous snapshot yet, this does
+   * nothing (the frame is dropped), so it is cheap to call every step.
    */
   void draw();
 
 private:
-  //! Draw a single robot onto the scene
-  void draw_robot(Robot *robot);
-  //! Add the current world time to the display
-  void draw_time();
+  //! Create the window and the textures drawn in it
+  void init_window();
+  //! Main loop of the render thread
+  void render_loop();
+  //! Copy the current state of the World into a snapshot
+  void take_snapshot(Snapshot &snapshot) const;
+  //! Handle window events and draw m_snapshot in the window
+  void render();
+  //! Zoom/pan the view (or close the window) in response to an event
+  void handle_event(const sf::Event &event);
+  /*!
+   * Zoom the view, keeping the same point under the given pixel
+   * @param factor Ratio of the new to the old view size (<1 zooms in)
+   * @param pixel Window position (pixels) that stays fixed
+   */
+  void zoom_view(const float factor, const sf::Vector2i pixel);
+  //! Keep the view within the World and the allowed zoom levels
+  void clamp_view();
+  //! Sort the robots in m_snapshot into the grid
+  void build_grid();
+  //! Draw the robots in the visible cells of the grid (in one draw call)
+  void draw_visible_robots();
+  //! Draw the robot density heatmap instead of individual robots
+  void draw_density();
+  /*!
+   * Set the quad for a single robot to its position, rotation, and color
+   * @param robot Robot to draw
+   * @param quad First of the 4 vertices of the robot's quad
+   */
+  void draw_robot(const RobotSnapshot &robot, sf::Vertex *quad);
+  //! Add the snapshot's world time to the display
+  void draw_time(const double time);
 };
 
 } // namespace Kilosim
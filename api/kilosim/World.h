@@ -11,11 +11,17 @@
 #include <kilosim/Robot.h>
 #include <kilosim/LightPattern.h>
 #include <kilosim/CollisionBoxes.h>
-#include <kilosim/Timer.h>
+#include <kilosim/LatencyHistogram.h>
+#include <kilosim/PerfCounters.h>
+#include <kilosim/Telemetry.h>
 
 #include <SFML/Graphics.hpp>
 
+#include <chrono>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -23,6 +29,30 @@
 
 namespace Kilosim
 {
+//! Timing statistics of one phase of World::step (see World::get_phase_stats)
+struct PhaseStats
+{
+  //! Name of the phase
+  std::string name;
+  //! Number of steps timed
+  uint64_t count;
+  //! Total time in the phase (seconds)
+  double total;
+  //! Mean time per step (seconds)
+  double mean;
+  //! Median time per step (seconds)
+  double p50;
+  //! 95th percentile time per step (seconds)
+  double p95;
+  //! 99th percentile time per step (seconds)
+  double p99;
+  //! Longest time in a step (seconds)
+  double max;
+  //! Hardware events counted in the phase, if enabled with
+  //! World::enable_perf_counters (0 otherwise, or if unavailable)
+  PerfCounts counters;
+};
+
 /*!
  * The `World` provides the base environment for running simulations. It
  * represents a two-dimensional bounded arena for simulating Kilobots.
@@ -44,37 +74,191 @@ namespace Kilosim
  */
 class World
 {
-private:
+protected:
   //! Robots in the world
   std::vector<Robot *> m_robots;
-  //! How many ticks per second in simulation
-  const uint16_t m_tick_rate = 32;
+  //! Robots created and owned by this World (by clone())
+  std::vector<std::unique_ptr<Robot>> m_owned_robots;
   //! Current tick of the system (starts at 0)
   uint32_t m_tick = 0;
-  //! Duration (seconds) of a tick
-  const double m_tick_delta_t = 1.0 / m_tick_rate;
   //! Number of ticks between messages (eg, 3 means 10 messages per second)
   const uint32_t m_comm_rate = 3;
   //! Height of the arena in mm
   const double m_arena_width;
   //! Width of the arena in mm
   const double m_arena_height;
+  //! Total messages delivered (one per receiving robot)
+  uint64_t m_messages_delivered = 0;
+
+private:
+  //! Every thread's random number generator state when this was cloned
+  std::string m_rand_snapshot;
+  //! Calling thread's random number generator state when this was cloned
+  std::string m_thread_rand_snapshot;
+  //! How many ticks per second in simulation
+  const uint16_t m_tick_rate = 32;
+  //! Duration (seconds) of a tick
+  const double m_tick_delta_t = 1.0 / m_tick_rate;
   //! probability of a controller executing its time step
   const double m_prob_control_execute = .99;
   //! Background light pattern image
   LightPattern m_light_pattern;
+  //! Light sensor x-positions of all robots (reused every tick)
+  std::vector<double> m_sensor_x;
+  //! Light sensor y-positions of all robots (reused every tick)
+  std::vector<double> m_sensor_y;
+  //! Rotations of all robots, for finding their light sensors
+  std::vector<double> m_sensor_theta;
+  //! Light sensor readings of all robots (reused every tick)
+  std::vector<uint16_t> m_light_readings;
+  //! Total robot-ticks spent colliding with another robot
+  uint64_t m_robot_collisions = 0;
+  //! Total robot-ticks spent colliding with a wall
+  uint64_t m_wall_collisions = 0;
 
-private:
+protected:
   CollisionBoxes cb;
-  Timer timer_controllers;
-  Timer timer_collisions;
-  Timer timer_move;
-  Timer timer_compute_next_step;
-  Timer timer_communicate;
-  Timer timer_step;
-  Timer timer_step_memory;
+
+  //! Phases of a step that are timed separately
+  enum Phase
+  {
+    PHASE_STEP_MEMORY,
+    PHASE_CONTROLLERS,
+    PHASE_COMMUNICATE,
+    PHASE_COMPUTE_NEXT_STEP,
+    PHASE_COLLISIONS,
+    PHASE_MOVE,
+    //! The whole step
+    PHASE_STEP,
+    NUM_PHASES
+  };
+  //! Clock used to time the phases
+  typedef std::chrono::steady_clock phase_clock;
+
+private:
+  //! Duration of each phase in every step since the last #reset_times
+  LatencyHistogram m_phase_times[NUM_PHASES];
+  //! Hardware counters of each OpenMP thread, indexed by thread number
+  //! (empty unless enabled; null for threads that weren't started)
+  std::vector<std::unique_ptr<PerfCounters>> m_perf;
+  //! Hardware events counted in each phase since the last #reset_times
+  PerfCounts m_phase_counts[NUM_PHASES] = {};
+  //! Hardware counts at the start of the current step
+  PerfCounts m_step_start_counts = {};
+  //! Hardware counts at the start of the current phase
+  PerfCounts m_phase_start_counts = {};
+  //! Live telemetry publisher (null unless enabled)
+  std::unique_ptr<Telemetry> m_telemetry;
+
+  //! Take a snapshot of the World's progress for telemetry
+  TelemetrySample get_telemetry_sample() const;
+
+  //! Range of robots (in x order) that a tile steps, and that it sees
+  struct TileRange
+  {
+    //! First robot of the tile (index into m_sorted)
+    size_t begin;
+    //! One past the last robot of the tile
+    size_t end;
+    //! First robot of the tile or its border
+    size_t border_begin;
+    //! One past the last robot of the tile or its border
+    size_t border_end;
+  };
+  //! Number of tiles the robots are split into (0 if tiling is disabled)
+  uint32_t m_num_tiles = 0;
+  //! Width (mm) of the border around a tile whose robots it sees
+  double m_tile_border = 0;
+  //! Number of ticks between rebalancing the tiles
+  uint32_t m_tile_rebalance_period = 0;
+  //! Tick the tiles were last rebalanced at
+  uint32_t m_tiles_balanced_tick = 0;
+  //! Indices of all robots, sorted by x-position (as of the start of the
+  //! step)
+  std::vector<uint32_t> m_sorted;
+  //! x-position of each robot in m_sorted
+  std::vector<double> m_sorted_x;
+  //! Left edge (mm) of each tile, followed by the right edge of the last
+  std::vector<double> m_tile_edges;
+  //! Robots in each tile and its border
+  std::vector<TileRange> m_tile_ranges;
+  //! Collision detection of each tile (covering the tile and its border)
+  std::vector<CollisionBoxes> m_tile_boxes;
+  //! Next positions of the robots in each tile and its border (reused)
+  std::vector<std::vector<RobotPose>> m_tile_poses;
+  //! (y-position, index) of the robots sending messages in each tile and
+  //! its border (reused)
+  std::vector<std::vector<std::pair<double, uint32_t>>> m_tile_senders;
+  //! Message each robot is sending this tick (null if none)
+  std::vector<void *> m_messages;
+  //! Number of times each robot's message was delivered this tick
+  std::vector<uint32_t> m_acks;
+
+  //! Sort the robots by x-position and find the robots in each tile (and
+  //! rebalance the tiles, if it's time)
+  void update_tiles();
+  //! Move the tile edges so each tile has the same number of robots
+  void rebalance_tiles();
+  //! Run the controllers of each tile in parallel
+  void run_controllers_tiled();
+  //! Send messages between robots, with each tile's receivers in parallel
+  void communicate_tiled();
+  //! Compute the next positions of each tile's robots in parallel
+  void compute_next_step_tiled(std::vector<RobotPose> &new_poses);
+  //! Check for collisions of each tile's robots in parallel
+  void find_collisions_tiled(const std::vector<RobotPose> &new_poses,
+                             std::vector<int16_t> &collisions);
+  //! Move each tile's robots in parallel
+  void move_robots_tiled(std::vector<RobotPose> &new_poses,
+                         const std::vector<int16_t> &collisions);
 
 protected:
+  /*!
+   * Construct a world whose collision detection only covers part of the
+   * arena (used by DistributedWorld, where each process only simulates a
+   * strip of the arena)
+   * @param collision_x0 Left edge (mm) of the region covered
+   * @param collision_width Width (mm) of the region covered
+   */
+  World(const double arena_width, const double arena_height,
+        const std::string light_pattern_src, const uint32_t num_threads,
+        const double collision_x0, const double collision_width);
+  /*!
+   * Deep copy of a World and its Robots (used by clone())
+   * @param other World to copy
+   */
+  World(const World &other);
+  //! Worlds can't be assigned (Robots are owned by pointer)
+  World &operator=(const World &) = delete;
+
+  /*!
+   * Start timing a step, and bring a time-varying light pattern up to date
+   * @return When the step started (to pass to #end_step)
+   */
+  phase_clock::time_point start_step();
+  //! Record the time in a phase since `start` (and trace it, if enabled),
+  //! and restart it at now
+  void end_phase(const Phase phase, phase_clock::time_point &start) noexcept;
+  /*!
+   * Finish a step: increment the tick, record the time of the whole step, and
+   * publish telemetry if it's due
+   * @param step_start When the step started, from #start_step
+   */
+  void end_step(const phase_clock::time_point step_start);
+
+  /*!
+   * Prepare a Robot to be simulated by this World (sets its light pattern and
+   * time step), without adding it to the Robots that are stepped
+   * @param robot Robot to attach
+   */
+  void attach_robot(Robot *robot);
+
+  /*!
+   * Read the light sensors of all robots at once, before the controllers run
+   * @param parallel Whether to read blocks of robots in parallel (when
+   * stepping tiles)
+   */
+  void update_light_readings(const bool parallel = false);
   //! Run the controllers (kilolib) for all robots
   void run_controllers();
   //! Send messages between robots
@@ -88,7 +272,9 @@ protected:
   void compute_next_step(std::vector<RobotPose> &new_poses);
   /*!
    * Check to see if motion causes robots to collide
-   * @param new_poses Check for collisions between these would-be next positions
+   * @param new_poses Check for collisions between these would-be next
+   * positions. The first entries are the World's robots; any after those are
+   * only obstacles (e.g., robots simulated by another process).
    * @param collisions Vector of whether/how each Robot is colliding (to be
    * filled by this function)
    * @return For each robot: 0 if no collision; -1 if wall collision; 1 if
@@ -123,10 +309,57 @@ public:
         const std::string light_pattern_src = "", const uint32_t num_threads = 0);
   //! Destructor, destroy all objects within the world
   /*!
-   * This does not destroy any Robots that have pointers stored in the world.
+   * This does not destroy any Robots that have pointers stored in the world,
+   * except those created by #clone.
    */
   virtual ~World();
 
+  /*!
+   * Create an independent deep copy of this World and all of its Robots, at
+   * the current tick. This is useful for branching many variants of a
+   * simulation (e.g., different parameters) from one shared warm-up.
+   *
+   * Every Robot is copied with `Robot::clone()`, which your Robot class must
+   * implement. The copies are owned (and deleted) by the new World.
+   *
+   * Random number generators in Kilosim are per-thread, not per-World, so
+   * the clone also keeps a snapshot of every thread's generator. Call
+   * #restore_rand_state on the clone before stepping it to continue the
+   * random sequence the original would have, or reseed to make variants
+   * diverge. (The sequence is only continued exactly when the original and
+   * the clone are stepped the same way, e.g., both without tiling.)
+   *
+   * A World stepped inside a parallel region (e.g., one variant per thread,
+   * as below) steps without tiling, since its nested threads would all share
+   * one random number generator. There, #restore_rand_state restores only the
+   * calling thread's generator, from the state of the thread that called
+   * #clone, so clone from the thread that ran the warm-up.
+   *
+   * ```
+   * world.step();  // ...warm-up
+   * std::vector<std::unique_ptr<Kilosim::World>> variants;
+   * for (int v = 0; v < num_variants; v++)
+   *   variants.push_back(world.clone());
+   * #pragma omp parallel for
+   * for (int v = 0; v < num_variants; v++)
+   * {
+   *   variants[v]->restore_rand_state();
+   *   // ...configure and run variant v
+   * }
+   * ```
+   *
+   * @return New World, owned by the caller
+   */
+  std::unique_ptr<World> clone() const;
+
+  /*!
+   * Set the random number generators to their state when this World was
+   * created by #clone: every thread's if called outside a parallel region, or
+   * only the calling thread's (from the cloning thread's) inside one. Does
+   * nothing for Worlds that weren't cloned.
+   */
+  void restore_rand_state() const;
+
   /*!
    * Run a step of the simulator.
    * This runs the controllers, communication, pseudo-physics, and movement
@@ -134,7 +367,7 @@ public:
    *
    * This is what you should call in your main function to run the simulation.
    */
-  void step();
+  virtual void step();
 
   /*!
    * Get the current light in the world
@@ -157,6 +390,57 @@ public:
    */
   void set_light_pattern(const std::string light_img_src);
 
+  /*!
+   * Set the world's light pattern to a sequence of image files, each shown
+   * for the same amount of time (starting from the current time). See
+   * LightPattern::set_light_sequence.
+   *
+   * @param light_img_srcs Names and locations of the image files, in order
+   * @param frame_duration How long each image is shown (seconds)
+   * @param loop Whether to restart the sequence after the last image
+   * @param prefetch Whether to load images on a background thread as they're
+   * needed, instead of all of them now
+   */
+  void set_light_sequence(const std::vector<std::string> light_img_srcs,
+                          const double frame_duration, const bool loop = true,
+                          const bool prefetch = false);
+
+  /*!
+   * Set the world's light pattern to a function of position and time, which
+   * is evaluated on a grid covering the World. See
+   * LightPattern::set_light_function.
+   *
+   * @param light_func Function giving the light intensity (0-1) at a
+   * position (mm) and time (seconds). It must be thread-safe.
+   * @param resolution Width/height (mm) of each grid cell
+   * @param update_period How often (seconds) to re-evaluate the function (0
+   * to re-evaluate every step)
+   */
+  void set_light_function(const lightFunc light_func,
+                          const double resolution = 10,
+                          const double update_period = 1);
+
+  /*!
+   * Set the world's light pattern to a tiled light map file (built with
+   * #build_light_map), for arenas too large to hold the light pattern as an
+   * image. See LightPattern::set_light_map.
+   *
+   * @param map_file Name/location of the light map file
+   * @param level Level of the light map's pyramid to sense light from
+   * @param memory_map Whether to memory-map the file (otherwise tiles are
+   * read into memory when first needed)
+   */
+  void set_light_map(const std::string map_file, const uint32_t level = 0,
+                     const bool memory_map = true);
+
+  /*!
+   * Get the version of the light pattern, which changes every time the light
+   * changes. Use this to tell when the image from #get_light_pattern needs
+   * to be reloaded.
+   * @return Version of the current light pattern
+   */
+  uint32_t get_light_version() const;
+
   /*!
    * Add a robot to the world by its pointer.
    * @warning It is possible right now to add a Robot twice, so be careful.
@@ -197,19 +481,187 @@ public:
    */
   std::vector<Robot *> &get_robots();
 
+  /*!
+   * Get the total number of messages delivered since the World was created
+   * (a message received by several robots counts once for each)
+   * @return Number of messages delivered
+   */
+  uint64_t get_messages_delivered() const;
+
+  /*!
+   * Get the total number of collisions between robots since the World was
+   * created (counted per robot, per tick)
+   * @return Number of robot-ticks spent colliding with another robot
+   */
+  uint64_t get_robot_collisions() const;
+
+  /*!
+   * Get the total number of collisions with the walls since the World was
+   * created (counted per robot, per tick)
+   * @return Number of robot-ticks spent colliding with a wall
+   */
+  uint64_t get_wall_collisions() const;
+
   /*!
    * Get the dimensions of the world (in mm)
    * @return 2-element [width, height] vector of dimensions in mm
    */
   std::vector<double> get_dimensions() const;
 
+  /*!
+   * Print the total, mean, and tail (p50/p95/p99/max) time of each phase of
+   * #step to stderr
+   */
   void printTimes() const;
 
+  /*!
+   * Get timing statistics of each phase of #step, for every step since the
+   * World was created (or since #reset_times). Every step's duration in each
+   * phase is recorded, so this shows the slow steps that totals hide.
+   * @return Statistics of each phase, in the order the phases run in a step,
+   * followed by the whole step ("step")
+   */
+  std::vector<PhaseStats> get_phase_stats() const;
+
+  /*!
+   * Get the total time spent in each phase of #step since the World was
+   * created (or since #reset_times), e.g. for benchmarking
+   * @return (phase name, seconds) pairs, in the order the phases run in a
+   * step, followed by the whole step ("step")
+   */
+  std::vector<std::pair<std::string, double>> get_phase_times() const;
+
+  //! Reset the times (and hardware counts) of each phase of #step (e.g.,
+  //! between trials, or to leave out warm-up steps when benchmarking)
+  void reset_times();
+
+  /*!
+   * Count hardware events (cycles, instructions, cache misses, and branch
+   * misses) in each phase of #step, with Linux `perf_event_open`. Counts are
+   * reported by #get_phase_stats and #printTimes.
+   *
+   * Events are counted on every OpenMP thread (opened on each one here, and
+   * summed per phase), so parallel work like tiled steps is included. Call
+   * it from the thread that calls #step, after the number of threads is set;
+   * threads started later (e.g., by nested parallel regions) aren't counted.
+   * Reading the counters adds a few microseconds per thread per step.
+   * If no counters are available (e.g., in a VM without hardware counters,
+   * or if `kernel.perf_event_paranoid` is too high), this prints a warning
+   * and steps are only timed.
+   *
+   * @return Whether any hardware counters are available
+   */
+  bool enable_perf_counters();
+
+  //! Stop counting hardware events in each phase of #step
+  void disable_perf_counters();
+
+private:
+  /*!
+   * Read the total hardware counts of all threads
+   * @param counts Filled with the summed counts
+   * @return Whether the counters could be read
+   */
+  bool read_perf_counters(PerfCounts &counts) const noexcept;
+
+public:
+
+  /*!
+   * Publish live telemetry while the simulation runs: every `period` seconds
+   * (of wall clock time), a JSON snapshot of the tick, ticks per second, time
+   * in each phase of #step, number of robots, messages delivered, and
+   * collisions. See Telemetry.
+   *
+   * Snapshots are written and sent on a background thread, so this doesn't
+   * slow down #step. Throws a `std::runtime_error` if the socket can't be
+   * created.
+   *
+   * @param filename JSON file to keep replacing with the latest snapshot
+   * (empty for none)
+   * @param socket_path Path of a UNIX datagram socket to send each snapshot
+   * to (empty for none)
+   * @param period Minimum wall clock time between snapshots (seconds)
+   */
+  void enable_telemetry(const std::string filename,
+                        const std::string socket_path = "",
+                        const double period = 1);
+
+  //! Publish a final telemetry snapshot and stop publishing
+  void disable_telemetry();
+
+  /*!
+   * Step the robots in spatial tiles, in parallel. The arena is split into
+   * vertical tiles with the same number of robots, and each thread steps the
+   * robots of one tile at a time: their controllers, messages received,
+   * next positions, collisions, and moves. Each tile only looks for message
+   * senders and collisions among its own robots and those within `border`
+   * of its edges, so threads work on nearby robots and large swarms no
+   * longer need to check every pair of robots for messages.
+   *
+   * As robots move, the tile edges are moved every `rebalance_period` ticks
+   * to keep the tiles the same size.
+   *
+   * Requirements and differences from the default (serial) step:
+   * - Controllers run in parallel, so they must only change their own Robot
+   *   (random numbers are per-thread, so they're fine).
+   * - Robots more than `border` apart (in x or y) never receive each other's
+   *   messages, so `border` must be at least the robots' communication range.
+   *   It must also be at least the collision diameter (`2 * RADIUS`), so robots
+   *   on both sides of a tile edge see each other; a smaller `border` throws a
+   *   `std::invalid_argument`.
+   * - Messages are received in a different order, and a sender's
+   *   `received()` is called after all messages are delivered.
+   * - Results depend on which thread steps which tile, so they aren't
+   *   reproducible run-to-run with more than one thread.
+   *
+   * Steps called from inside a parallel region (e.g., one #clone per thread)
+   * don't use tiles. DistributedWorld has its own step and doesn't use tiles.
+   *
+   * @param num_tiles Number of tiles (0 for one per OpenMP thread)
+   * @param border Width (mm) of the border around each tile that it sees
+   * @param rebalance_period Number of ticks between rebalancing the tiles
+   */
+  void enable_tiling(const uint32_t num_tiles = 0, const double border = 100,
+                     const uint32_t rebalance_period = 32);
+
+  //! Go back to stepping all of the robots serially
+  void disable_tiling();
+
   /*!
     * Check that the world is in a valid state. Throws an exception if a problem
     * is found.
   */
   void check_validity() const;
+
+  /*!
+   * Save the state of the simulation to a binary checkpoint file, so it can
+   * be resumed later with #load_checkpoint.
+   *
+   * This saves the current tick, the totals of messages and collisions (see
+   * #get_messages_delivered), the complete state of every Robot (see
+   * `Robot::save_checkpoint()`, including your controller's state if it
+   * implements `Kilobot::save_state()`), and the state of the random number
+   * generators. The light pattern is not saved.
+   *
+   * @param filename Name/location of the checkpoint file to write
+   */
+  void save_checkpoint(const std::string filename) const;
+
+  /*!
+   * Restore the simulation from a checkpoint written by #save_checkpoint.
+   *
+   * The World must already be set up the same way as the one that was saved:
+   * the same dimensions and light pattern, with the same types of Robots
+   * added in the same order. (Their initial positions don't matter, since
+   * they are overwritten.) Stepping the restored World then continues the
+   * saved simulation exactly, as if it had never stopped.
+   *
+   * Throws a `std::runtime_error` if the file can't be read or doesn't match
+   * this World, in which case the World is left unchanged.
+   *
+   * @param filename Name/location of the checkpoint file to read
+   */
+  void load_checkpoint(const std::string filename);
 };
 } // namespace Kilosim
 
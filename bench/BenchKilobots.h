@@ -0,0 +1,245 @@
+/*
+  Kilosim
+
+  Controllers for the canonical benchmark scenarios run by kilosim_bench
+
+  Created 2026-10
+*/
+
+#ifndef __KILOSIM_BENCHKILOBOTS_H
+#define __KILOSIM_BENCHKILOBOTS_H
+
+#include <kilosim/Kilobot.h>
+
+namespace Kilosim
+{
+/*!
+ * Shared behavior of the benchmark controllers: a random walk that
+ * broadcasts a message every tick, and saves its state for checkpoints
+ */
+class BenchKilobot : public Kilobot
+{
+protected:
+  //! Motions of the random walk
+  enum Motion
+  {
+    STOP,
+    FORWARD,
+    LEFT,
+    RIGHT
+  };
+
+  message_t m_transmit_msg;
+  //! Current motion
+  uint8_t m_motion = STOP;
+  //! Tick when the motion was last changed
+  uint32_t m_last_changed = 0;
+  //! Number of ticks until the motion is changed again
+  uint32_t m_change_after = 0;
+  //! Distance (mm) to the nearest neighbor heard since the last loop
+  uint8_t m_nearest = 255;
+  //! Number of messages received since the last loop
+  uint16_t m_num_heard = 0;
+
+  void set_motion(const uint8_t motion)
+  {
+    if (m_motion == motion)
+    {
+      return;
+    }
+    m_motion = motion;
+    if (motion == STOP)
+    {
+      set_motors(0, 0);
+    }
+    else
+    {
+      spinup_motors();
+      if (motion == FORWARD)
+        set_motors(kilo_straight_left, kilo_straight_right);
+      else if (motion == LEFT)
+        set_motors(kilo_turn_left, 0);
+      else
+        set_motors(0, kilo_turn_right);
+    }
+  }
+
+  //! Take a random step of the walk, if it's time to change direction
+  void random_walk()
+  {
+    if (kilo_ticks > m_last_changed + m_change_after)
+    {
+      m_last_changed = kilo_ticks;
+      m_change_after = ((rand_hard() % 4) + 1) * 32;
+      const uint8_t dice = rand_hard() % 4;
+      set_motion(dice <= 1 ? FORWARD : (dice == 2 ? LEFT : RIGHT));
+    }
+  }
+
+  //! Forget the neighbors heard since the last loop
+  void clear_neighbors()
+  {
+    m_nearest = 255;
+    m_num_heard = 0;
+  }
+
+  void setup()
+  {
+    m_transmit_msg.type = NORMAL;
+    m_transmit_msg.data[0] = 0;
+    m_transmit_msg.crc = message_crc(&m_transmit_msg);
+    set_color(RGB(0, 0, 1));
+    set_motion(FORWARD);
+  }
+
+  void message_rx(message_t *, distance_measurement_t *dist)
+  {
+    const uint8_t d = estimate_distance(dist);
+    if (d < m_nearest)
+      m_nearest = d;
+    m_num_heard++;
+  }
+
+  message_t *message_tx()
+  {
+    return &m_transmit_msg;
+  }
+
+  void message_tx_success() {}
+
+  void save_state(std::ostream &out) const
+  {
+    checkpoint_write(out, m_transmit_msg);
+    checkpoint_write(out, m_motion);
+    checkpoint_write(out, m_last_changed);
+    checkpoint_write(out, m_change_after);
+    checkpoint_write(out, m_nearest);
+    checkpoint_write(out, m_num_heard);
+  }
+
+  void load_state(std::istream &in)
+  {
+    checkpoint_read(in, m_transmit_msg);
+    checkpoint_read(in, m_motion);
+    checkpoint_read(in, m_last_changed);
+    checkpoint_read(in, m_change_after);
+    checkpoint_read(in, m_nearest);
+    checkpoint_read(in, m_num_heard);
+  }
+};
+
+/*!
+ * Sparse dispersal: robots start packed together and move away from any
+ * neighbor they hear, so the swarm spreads out over the arena
+ */
+class DispersalKilobot : public BenchKilobot
+{
+protected:
+  void loop()
+  {
+    if (m_num_heard > 0 && m_nearest < 80)
+    {
+      // Too close: turn away and walk off
+      set_color(RGB(1, 0, 0));
+      set_motion(kilo_ticks % 2 ? LEFT : RIGHT);
+      m_last_changed = kilo_ticks;
+      m_change_after = 32;
+    }
+    else
+    {
+      set_color(RGB(0, 1, 0));
+      random_walk();
+    }
+    clear_neighbors();
+  }
+
+  Robot *clone() const
+  {
+    return new DispersalKilobot(*this);
+  }
+};
+
+/*!
+ * Dense aggregation: robots walk randomly, and stop while they hear enough
+ * neighbors, so they form clusters in a crowded arena
+ */
+class AggregationKilobot : public BenchKilobot
+{
+protected:
+  void loop()
+  {
+    if (m_num_heard >= 3)
+    {
+      set_color(RGB(1, 0, 1));
+      set_motion(STOP);
+      // Stay stopped for a while before walking again
+      m_last_changed = kilo_ticks;
+      m_change_after = 64;
+    }
+    else
+    {
+      set_color(RGB(0, 0, 1));
+      random_walk();
+    }
+    clear_neighbors();
+  }
+
+  Robot *clone() const
+  {
+    return new AggregationKilobot(*this);
+  }
+};
+
+/*!
+ * Phototaxis: robots sense light every tick and keep going while it gets
+ * brighter, tumbling when it gets darker, so they climb the light gradient
+ */
+class PhototaxisKilobot : public BenchKilobot
+{
+protected:
+  //! Light reading from the previous loop
+  int16_t m_last_light = -1;
+
+  void loop()
+  {
+    const int16_t light = get_ambientlight();
+    if (light > 900)
+    {
+      set_color(RGB(1, 1, 0));
+      set_motion(STOP);
+    }
+    else if (m_last_light >= 0 && light < m_last_light)
+    {
+      // Getting darker: tumble
+      set_color(RGB(1, 0, 0));
+      set_motion(rand_hard() % 2 ? LEFT : RIGHT);
+    }
+    else
+    {
+      set_color(RGB(0, 1, 0));
+      set_motion(FORWARD);
+    }
+    m_last_light = light;
+    clear_neighbors();
+  }
+
+  Robot *clone() const
+  {
+    return new PhototaxisKilobot(*this);
+  }
+
+  void save_state(std::ostream &out) const
+  {
+    BenchKilobot::save_state(out);
+    checkpoint_write(out, m_last_light);
+  }
+
+  void load_state(std::istream &in)
+  {
+    BenchKilobot::load_state(in);
+    checkpoint_read(in, m_last_light);
+  }
+};
+} // namespace Kilosim
+
+#endif
@@ -0,0 +1,386 @@
+/*
+    Kilosim
+
+    Step-throughput benchmark: runs canonical scenarios over a sweep of robot
+    counts, arena sizes, step modes, and thread counts, and reports
+    ticks/second and the time spent in each phase of World::step (total and
+    per-tick percentiles) as JSON or CSV.
+
+    The default (serial) step doesn't use threads, so it is run once per
+    scenario with 1 thread; only tiled runs (World::enable_tiling) sweep the
+    thread counts.
+
+    Usage: kilosim_bench [options]
+      --scenarios LIST  Scenarios to run (dispersal,aggregation,phototaxis)
+      --robots LIST     Numbers of robots (default 100,400)
+      --arena LIST      Widths (mm) of the square arena (default 2400,4800)
+      --modes LIST      Step modes to run (serial,tiled; default both)
+      --threads LIST    Numbers of threads for tiled runs (default 1 and all
+                        cores)
+      --ticks N         Ticks timed per run (default 200)
+      --warmup N        Ticks run before timing (default 20)
+      --seed N          Random seed (default 1)
+      --perf            Also count hardware events (cycles, instructions,
+                        cache and branch misses) in each phase, if available
+      --format FORMAT   json (default) or csv
+      --output FILE     Write results to a file instead of stdout
+
+    Created 2026-10
+*/
+
+#include <BenchKilobots.h>
+
+#include <kilosim/World.h>
+#include <kilosim/Random.h>
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+//! Results of one benchmark run
+struct BenchResult
+{
+    std::string scenario;
+    size_t num_robots;
+    double arena_width;
+    uint32_t num_threads;
+    bool tiled;
+    uint32_t ticks;
+    double seconds;
+    std::vector<Kilosim::PhaseStats> phases;
+};
+
+//! Split a comma-separated list
+static std::vector<std::string> split_list(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+//! Parse a number that's at least min_val (exits if invalid)
+template <typename T>
+static T parse_value(const std::string &option, const std::string &item,
+                     const T min_val = 1)
+{
+    std::stringstream ss(item);
+    T val;
+    if (item.empty() || item[0] == '-' || !(ss >> val) || !ss.eof() ||
+        val < min_val)
+    {
+        std::cerr << "ERROR: Invalid value '" << item << "' for " << option << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return val;
+}
+
+//! Parse a comma-separated list of positive numbers (exits if invalid)
+template <typename T>
+static std::vector<T> parse_list(const std::string &option, const std::string &list)
+{
+    std::vector<T> values;
+    for (auto &item : split_list(list))
+        values.push_back(parse_value<T>(option, item));
+    if (values.empty())
+    {
+        std::cerr << "ERROR: No values given for " << option << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return values;
+}
+
+//! Create a robot running a scenario's controller
+static Kilosim::Robot *make_robot(const std::string &scenario)
+{
+    if (scenario == "dispersal")
+        return new Kilosim::DispersalKilobot();
+    else if (scenario == "aggregation")
+        return new Kilosim::AggregationKilobot();
+    else
+        return new Kilosim::PhototaxisKilobot();
+}
+
+/*!
+ * Place robots on a square grid centered in the arena. Dispersal starts
+ * tightly packed in the middle; the others are spread over the whole arena.
+ * @return Whether the robots fit in the arena
+ */
+static bool place_robots(const std::string &scenario,
+                         std::vector<Kilosim::Robot *> &robots,
+                         const double arena_width)
+{
+    const size_t per_row = std::ceil(std::sqrt((double)robots.size()));
+    // Leave a gap between robots and from the walls
+    const double min_spacing = 2 * RADIUS + 4;
+    const double spacing = scenario == "dispersal"
+                               ? min_spacing
+                               : arena_width / per_row;
+    if (spacing < min_spacing || per_row * spacing > arena_width)
+        return false;
+    const double offset = (arena_width - (per_row - 1) * spacing) / 2;
+    for (size_t n = 0; n < robots.size(); n++)
+    {
+        robots[n]->robot_init(offset + (n % per_row) * spacing,
+                              offset + (n / per_row) * spacing,
+                              uniform_rand_real(0, 2 * PI));
+    }
+    return true;
+}
+
+//! Run a scenario and time it
+static bool run_bench(BenchResult &result, const uint32_t warmup,
+                      const bool perf)
+{
+    Kilosim::World world(result.arena_width, result.arena_width, "",
+                         result.num_threads);
+    if (perf)
+        world.enable_perf_counters();
+    if (result.tiled)
+        world.enable_tiling(result.num_threads);
+    if (result.scenario == "phototaxis")
+    {
+        // Light gradient from dark (left) to bright (right)
+        const double width = result.arena_width;
+        world.set_light_function(
+            [width](double x, double, double) { return x / width; });
+    }
+
+    std::vector<Kilosim::Robot *> robots(result.num_robots);
+    for (auto &robot : robots)
+    {
+        robot = make_robot(result.scenario);
+        world.add_robot(robot);
+    }
+    const bool fits = place_robots(result.scenario, robots, result.arena_width);
+    if (fits)
+    {
+        for (uint32_t t = 0; t < warmup; t++)
+            world.step();
+        world.reset_times();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t t = 0; t < result.ticks; t++)
+            world.step();
+        const auto end = std::chrono::steady_clock::now();
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.phases = world.get_phase_stats();
+    }
+    for (auto &robot : robots)
+        delete robot;
+    return fits;
+}
+
+static void write_json(std::ostream &out, const std::vector<BenchResult> &results)
+{
+    json runs = json::array();
+    for (auto &r : results)
+    {
+        json phases = json::object();
+        for (auto &phase : r.phases)
+        {
+            phases[phase.name] = {{"total", phase.total},
+                                  {"mean", phase.mean},
+                                  {"p50", phase.p50},
+                                  {"p95", phase.p95},
+                                  {"p99", phase.p99},
+                                  {"max", phase.max}};
+            for (int c = 0; c < Kilosim::NUM_PERF_COUNTERS; c++)
+            {
+                const Kilosim::PerfCounter counter = (Kilosim::PerfCounter)c;
+                phases[phase.name][Kilosim::PerfCounters::get_name(counter)] =
+                    phase.counters[c];
+            }
+        }
+        runs.push_back({{"scenario", r.scenario},
+                        {"num_robots", r.num_robots},
+                        {"arena_width", r.arena_width},
+                        {"num_threads", r.num_threads},
+                        {"tiled", r.tiled},
+                        {"ticks", r.ticks},
+                        {"seconds", r.seconds},
+                        {"ticks_per_sec", r.ticks / r.seconds},
+                        {"robot_ticks_per_sec", r.ticks * r.num_robots / r.seconds},
+                        {"phase_seconds", phases}});
+    }
+    out << json({{"benchmark", "kilosim_bench"}, {"runs", runs}}).dump(2) << std::endl;
+}
+
+static void write_csv(std::ostream &out, const std::vector<BenchResult> &results)
+{
+    out << "scenario,num_robots,arena_width,num_threads,tiled,ticks,seconds,"
+        << "ticks_per_sec,robot_ticks_per_sec";
+    if (!results.empty())
+    {
+        for (auto &phase : results[0].phases)
+        {
+            out << "," << phase.name << "_seconds," << phase.name << "_p50,"
+                << phase.name << "_p99," << phase.name << "_max";
+            for (int c = 0; c < Kilosim::NUM_PERF_COUNTERS; c++)
+                out << "," << phase.name << "_"
+                    << Kilosim::PerfCounters::get_name((Kilosim::PerfCounter)c);
+        }
+    }
+    out << std::endl;
+    for (auto &r : results)
+    {
+        out << r.scenario << "," << r.num_robots << "," << r.arena_width << ","
+            << r.num_threads << "," << r.tiled << "," << r.ticks << ","
+            << r.seconds << ","
+            << r.ticks / r.seconds << "," << r.ticks * r.num_robots / r.seconds;
+        for (auto &phase : r.phases)
+        {
+            out << "," << phase.total << "," << phase.p50 << "," << phase.p99
+                << "," << phase.max;
+            for (auto count : phase.counters)
+                out << "," << count;
+        }
+        out << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> scenarios = {"dispersal", "aggregation", "phototaxis"};
+    std::vector<size_t> robot_counts = {100, 400};
+    std::vector<double> arena_widths = {2400, 4800};
+    std::vector<uint32_t> thread_counts = {1};
+    const uint32_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads > 1)
+        thread_counts.push_back(max_threads);
+    uint32_t ticks = 200;
+    uint32_t warmup = 20;
+    uint32_t seed = 1;
+    std::string format = "json";
+    std::string output;
+    std::vector<std::string> modes = {"serial", "tiled"};
+    bool perf = false;
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        if (args[i] == "--perf")
+        {
+            perf = true;
+            continue;
+        }
+        if (i + 1 >= args.size())
+        {
+            std::cerr << "ERROR: Missing value for " << args[i] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        const std::string &option = args[i];
+        const std::string &value = args[++i];
+        if (option == "--scenarios")
+        {
+            scenarios = split_list(value);
+            for (auto &s : scenarios)
+            {
+                if (s != "dispersal" && s != "aggregation" && s != "phototaxis")
+                {
+                    std::cerr << "ERROR: Unknown scenario '" << s << "'" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        else if (option == "--modes")
+        {
+            modes = split_list(value);
+            for (auto &m : modes)
+            {
+                if (m != "serial" && m != "tiled")
+                {
+                    std::cerr << "ERROR: Unknown step mode '" << m << "'" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        else if (option == "--robots")
+            robot_counts = parse_list<size_t>(option, value);
+        else if (option == "--arena")
+            arena_widths = parse_list<double>(option, value);
+        else if (option == "--threads")
+            thread_counts = parse_list<uint32_t>(option, value);
+        else if (option == "--ticks")
+            ticks = parse_value<uint32_t>(option, value);
+        else if (option == "--warmup")
+            warmup = parse_value<uint32_t>(option, value, 0);
+        else if (option == "--seed")
+            seed = parse_value<uint32_t>(option, value, 0);
+        else if (option == "--format" && (value == "json" || value == "csv"))
+            format = value;
+        else if (option == "--output")
+            output = value;
+        else
+        {
+            std::cerr << "ERROR: Invalid option " << option << " " << value << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (auto &scenario : scenarios)
+    {
+        for (auto num_robots : robot_counts)
+        {
+            for (auto arena_width : arena_widths)
+            {
+                for (auto &mode : modes)
+                {
+                    const bool tiled = mode == "tiled";
+                    // The serial step is the same with any number of threads
+                    const std::vector<uint32_t> mode_threads =
+                        tiled ? thread_counts : std::vector<uint32_t>{1};
+                    for (auto num_threads : mode_threads)
+                    {
+                        // Every run starts from the same random state
+                        seed_rand(seed);
+                        BenchResult result = {scenario, num_robots, arena_width,
+                                              num_threads, tiled, ticks, 0, {}};
+                        std::cerr << scenario << ": " << num_robots << " robots, "
+                                  << arena_width << " mm, " << mode << ", "
+                                  << num_threads << " threads... ";
+                        if (!run_bench(result, warmup, perf))
+                        {
+                            std::cerr << "skipped (robots don't fit)" << std::endl;
+                            continue;
+                        }
+                        std::cerr << ticks / result.seconds << " ticks/s" << std::endl;
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+
+    std::ofstream out_file;
+    if (!output.empty())
+    {
+        out_file.open(output);
+        if (!out_file)
+        {
+            std::cerr << "ERROR: Failed to open " << output << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::ostream &out = output.empty() ? std::cout : out_file;
+    if (format == "csv")
+        write_csv(out, results);
+    else
+        write_json(out, results);
+    return 0;
+}
@@ -0,0 +1,54 @@
+import h5py
+import numpy as np
+import argparse
+
+
+def decode_trajectory(h5_trial, traj_name):
+    """
+    Decode a quantized trajectory saved by Logger::add_trajectory
+
+    Returns a dict of float arrays: 'time' [t], 'x' and 'y' (mm) [t x n],
+    'theta' (radians) [t x n], and 'color' (0-1) [t x n x 3]
+    """
+    traj = h5_trial[traj_name]
+    frames = traj[...]
+    x = frames['x']
+    y = frames['y']
+    theta = frames['theta']
+    color = frames['color']
+    if traj.attrs['delta_encoded']:
+        # Frames are wrapping differences from the previous frame, so a
+        # cumulative sum in the same integer width restores the values
+        x = np.cumsum(x, axis=0, dtype=np.uint16)
+        y = np.cumsum(y, axis=0, dtype=np.uint16)
+        theta = np.cumsum(theta, axis=0, dtype=np.uint16)
+        color = np.cumsum(color, axis=0, dtype=np.uint8)
+    return {
+        'time': h5_trial[traj_name + '_time'][...],
+        'x': x * traj.attrs['position_resolution'],
+        'y': y * traj.attrs['position_resolution'],
+        'theta': theta * traj.attrs['theta_resolution'],
+        'color': color * traj.attrs['color_resolution'],
+    }
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Decode a quantized trajectory from a Kilosim log file")
+    parser.add_argument(
+        'filename', type=str,
+        help='HDF5 file to read')
+    parser.add_argument(
+        'trial', type=str,
+        help='Trial group containing the trajectory (e.g., trial_1)')
+    parser.add_argument(
+        'traj_name', type=str,
+        help='Name of the trajectory dataset')
+
+    args = parser.parse_args()
+
+    h5_file = h5py.File(args.filename, 'r')
+    decoded = decode_trajectory(h5_file[args.trial], args.traj_name)
+    for name, val in decoded.items():
+        print(name, val.shape)
+    h5_file.close()
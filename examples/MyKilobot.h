@@ -127,5 +127,36 @@ class MyKilobot : public Kilobot
     }
 
     void message_tx_success() {}
+
+    // Allows World::clone() to copy this robot
+    Robot *clone() const
+    {
+        return new MyKilobot(*this);
+    }
+
+    // Save/restore everything that changes, for World checkpoints
+    void save_state(std::ostream &out) const
+    {
+        checkpoint_write(out, light_intensity);
+        checkpoint_write(out, transmit_msg);
+        checkpoint_write(out, new_message);
+        checkpoint_write(out, last_checked);
+        checkpoint_write(out, random_number);
+        checkpoint_write(out, dice);
+        checkpoint_write(out, curr_motion);
+        checkpoint_write(out, next_check_dur);
+    }
+
+    void load_state(std::istream &in)
+    {
+        checkpoint_read(in, light_intensity);
+        checkpoint_read(in, transmit_msg);
+        checkpoint_read(in, new_message);
+        checkpoint_read(in, last_checked);
+        checkpoint_read(in, random_number);
+        checkpoint_read(in, dice);
+        checkpoint_read(in, curr_motion);
+        checkpoint_read(in, next_check_dur);
+    }
 };
 } // namespace Kilosim
\ No newline at end of file
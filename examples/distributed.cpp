@@ -0,0 +1,94 @@
+/*
+    Example of splitting a large World across MPI processes
+
+    Run with, e.g.:
+    mpirun -n 4 kilosim_distributed [num_robots] [num_ticks]
+*/
+
+#include <MyKilobot.h>
+
+#include <kilosim/DistributedWorld.h>
+#include <kilosim/Logger.h>
+#include <kilosim/Random.h>
+
+#include <mpi.h>
+
+#include <chrono>
+#include <cmath>
+#include <string>
+
+std::vector<double> mean_light(std::vector<Kilosim::Robot *> &robots)
+{
+    double sum = 0;
+    for (auto &robot : robots)
+    {
+        sum += ((Kilosim::MyKilobot *)robot)->light_intensity;
+    }
+    return {robots.size() > 0 ? sum / robots.size() : 0};
+}
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    {
+        const int num_robots = argc > 1 ? std::stoi(argv[1]) : 10000;
+        const int num_ticks = argc > 2 ? std::stoi(argv[2]) : 320;
+
+        // Square arena with robots on a grid, 100 mm apart
+        const int per_row = std::ceil(std::sqrt(num_robots));
+        const double arena_width = per_row * 100 + 100;
+        Kilosim::DistributedWorld world(
+            arena_width, arena_width,
+            [] { return new Kilosim::MyKilobot(); });
+
+        // Each rank needs its own random numbers
+        seed_rand(1234 + world.get_rank());
+
+        // Each rank only creates the robots in its own strip
+        for (int n = 0; n < num_robots; n++)
+        {
+            const double x = (n % per_row) * 100 + 100;
+            const double y = (n / per_row) * 100 + 100;
+            if (world.in_domain(x))
+            {
+                Kilosim::Robot *robot = new Kilosim::MyKilobot();
+                world.add_robot(robot);
+                robot->robot_init(x, y, PI * n / 2);
+            }
+        }
+
+        // Each rank logs its own robots to its own file
+        Kilosim::Logger logger(
+            world,
+            "distributed-log-" + std::to_string(world.get_rank()) + ".h5",
+            1, true);
+        logger.add_aggregator("mean_light", mean_light);
+
+        const uint64_t total_robots = world.get_total_robots();
+        const auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < num_ticks; t++)
+        {
+            world.step();
+            if (world.get_tick() % (10 * world.get_tick_rate()) == 0)
+            {
+                logger.log_state();
+            }
+        }
+        const double seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+
+        // Check that no robots were lost or duplicated between ranks
+        const std::vector<Kilosim::RobotPose> poses = world.gather_poses();
+        const uint64_t final_robots = world.get_total_robots();
+        if (world.get_rank() == 0)
+        {
+            printf("%d ranks, %lu robots (%lu at end, %lu gathered): %.1f ticks/s\n",
+                   world.get_num_ranks(), (unsigned long)total_robots,
+                   (unsigned long)final_robots, (unsigned long)poses.size(),
+                   num_ticks / seconds);
+        }
+    }
+    MPI_Finalize();
+    return 0;
+}
@@ -1,12 +1,33 @@
 #include <MyKilobot.h>
 
+#include <kilosim/ConfigBinder.h>
 #include <kilosim/ConfigParser.h>
 #include <kilosim/Kilobot.h>
 #include <kilosim/Logger.h>
 #include <kilosim/Random.h>
+#include <kilosim/Scenario.h>
 #include <kilosim/Timer.h>
+#include <kilosim/Trace.h>
 #include <kilosim/Viewer.h>
 
+// Parameters of the experiment, read from the config file
+struct Params
+{
+    uint32_t seed;
+    uint start_trial;
+    uint num_trials;
+    double trial_duration; // seconds
+    uint log_freq;
+    double world_width;
+    double world_height;
+    std::string light_pattern_filename;
+    uint32_t num_threads;
+    int num_robots;
+    std::string log_filename;
+    std::string scenario_filename;
+    std::string telemetry_filename;
+};
+
 std::vector<double> mean_colors(std::vector<Kilosim::Robot *> &robots)
 {
     // Get the mean color for all 3 LED color components
@@ -41,27 +62,53 @@ int main(int argc, char *argv[])
     }
     Kilosim::ConfigParser config(args[1]);
 
-    seed_rand(config.get("seed"));
+    // Read (and check) all of the parameters up front
+    Params params;
+    Kilosim::ConfigBinder binder(config);
+    binder.bind("seed", params.seed)
+        .bind("start_trial", params.start_trial)
+        .bind("num_trials", params.num_trials)
+        .bind("trial_duration", params.trial_duration)
+        .bind("log_freq", params.log_freq)
+        .bind("world_width", params.world_width)
+        .bind("world_height", params.world_height)
+        .bind("light_pattern_filename", params.light_pattern_filename, std::string(""))
+        .bind("num_threads", params.num_threads, 0u)
+        .bind("num_robots", params.num_robots)
+        .bind("log_filename", params.log_filename)
+        .bind("scenario_filename", params.scenario_filename, std::string(""))
+        .bind("telemetry_filename", params.telemetry_filename, std::string(""));
+    binder.resolve();
+
+    // Robot placements can come from a scenario file instead of a grid
+    Kilosim::Scenario scenario;
+    if (!params.scenario_filename.empty())
+    {
+        scenario = Kilosim::load_scenario(params.scenario_filename);
+        params.num_robots = scenario.size();
+    }
 
-    uint start_trial = config.get("start_trial");
-    uint num_trials = config.get("num_trials");
-    double trial_duration = config.get("trial_duration"); // seconds
-    uint log_freq = config.get("log_freq");
+    seed_rand(params.seed);
+
+    uint start_trial = params.start_trial;
+    uint num_trials = params.num_trials;
+    double trial_duration = params.trial_duration;
+    uint log_freq = params.log_freq;
 
     for (uint trial = start_trial; trial < (num_trials + start_trial); trial++)
     {
         // Create world
         Kilosim::World world(
-            config.get("world_width"),
-            config.get("world_height"),
-            config.get("light_pattern_filename"),
-            config.get("num_threads"));
+            params.world_width,
+            params.world_height,
+            params.light_pattern_filename,
+            params.num_threads);
 
         // Create robot(s)
         // Creates a grid of 23x23 robots (can handle up to 529 robots)
         // That's the most that will fit into a 2.4x2.4 m arena with this spacing
         int num_rows = 23;
-        int num_robots = config.get("num_robots");
+        int num_robots = params.num_robots;
         std::vector<Kilosim::Robot *> robots;
         robots.resize(num_robots);
         for (int n = 0; n < num_robots; n++)
@@ -69,21 +116,42 @@ int main(int argc, char *argv[])
             // std::cout << n * 50 + 20 << std::endl;
             robots[n] = new Kilosim::MyKilobot();
             world.add_robot(robots[n]);
-            robots[n]->robot_init(floor(n / num_rows) * 100 + 75, (n % num_rows) * 100 + 75, PI * n / 2);
+            if (params.scenario_filename.empty())
+                robots[n]->robot_init(floor(n / num_rows) * 100 + 75, (n % num_rows) * 100 + 75, PI * n / 2);
         }
+        if (!params.scenario_filename.empty())
+            scenario.init_robots(robots);
 
         world.check_validity();
 
+        // Progress and speed of the trial, updated every second while it runs
+        if (!params.telemetry_filename.empty())
+            world.enable_telemetry(params.telemetry_filename);
+
         Kilosim::Logger logger(
             world,
-            config.get("log_filename"),
+            params.log_filename,
             trial,
             true);
         logger.add_aggregator("mean_led_colors", mean_colors);
+        // Allocation-free aggregator: writes into a row preallocated by Logger
+        // This one is logged every second by log_due(), with its own time series
+        logger.add_aggregator(
+            "max_light", 1,
+            [](std::vector<Kilosim::Robot *> &robots, double *out, size_t) {
+                out[0] = 0;
+                for (auto &robot : robots)
+                {
+                    Kilosim::MyKilobot *kb = (Kilosim::MyKilobot *)robot;
+                    out[0] = std::max(out[0], (double)kb->light_intensity);
+                }
+            },
+            1);
         logger.log_config(config);
 
         // Create Viewer to visualize the world
-        Kilosim::Viewer viewer(world);
+        // It renders on its own thread, so it doesn't slow down the simulation
+        Kilosim::Viewer viewer(world, 1080, true);
 
         int step_count = 0;
         while (world.get_time() < trial_duration)
@@ -96,9 +164,12 @@ int main(int argc, char *argv[])
             world.step();
             timer_step.stop();
 
-            // Draw the world
+            // Draw the world (only copies the robots when a new frame is needed)
             viewer.draw();
 
+            // Log any aggregators with their own logging period that are due
+            logger.log_due();
+
             if ((world.get_tick() % (log_freq * world.get_tick_rate())) == 0)
             {
                 // Log the state of the world every 5 seconds
@@ -108,7 +179,13 @@ int main(int argc, char *argv[])
             }
         }
 
+        world.disable_telemetry();
         world.printTimes();
+#ifdef KILOSIM_TRACE
+        // Timeline of this trial (open in chrome://tracing or ui.perfetto.dev)
+        Kilosim::write_trace("kilosim-trace-" + std::to_string(trial) + ".json");
+        Kilosim::clear_trace();
+#endif
         for (int n = 0; n < num_robots; n++)
             delete robots[n];
 
@@ -0,0 +1,52 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/ConfigBinder.h>
+
+namespace Kilosim
+{
+ConfigBinder::ConfigBinder(const ConfigParser &config)
+    : m_config(config)
+{
+}
+
+void ConfigBinder::resolve() const
+{
+    const json &config = m_config.get();
+    size_t num_errors = 0;
+    for (auto &binding : m_bindings)
+    {
+        auto it = config.find(binding.name);
+        if (it == config.end())
+        {
+            if (binding.set_default)
+            {
+                binding.set_default();
+            }
+            else
+            {
+                std::cerr << "ERROR: Missing config value '" << binding.name
+                          << "'" << std::endl;
+                num_errors++;
+            }
+            continue;
+        }
+        const std::string error = binding.read(*it);
+        if (!error.empty())
+        {
+            std::cerr << "ERROR: Invalid config value '" << binding.name
+                      << "': " << error << std::endl;
+            num_errors++;
+        }
+    }
+    if (num_errors > 0)
+    {
+        std::cerr << "ERROR: " << num_errors << " invalid config value(s) in "
+                  << m_config.get_filename() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+} // namespace Kilosim
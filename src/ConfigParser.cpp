@@ -6,8 +6,19 @@
 
 #include <kilosim/ConfigParser.h>
 
+#include <cmath>
+
 namespace Kilosim
 {
+//! Mix a 64-bit value into a well-distributed one (SplitMix64 finalizer)
+static uint64_t splitmix64(uint64_t z)
+{
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
 ConfigParser::ConfigParser(const std::string config_file)
     : m_config_file(config_file)
 {
@@ -23,9 +34,15 @@ ConfigParser::ConfigParser(const std::string config_file)
                   << config_file << std::endl;
         exit(EXIT_FAILURE);
     }
+    parse_sweep();
 }
 
-json ConfigParser::get(const std::string val_name) const
+ConfigParser::ConfigParser(const std::string config_file, const json config)
+    : m_config_file(config_file), m_config(config)
+{
+}
+
+const json &ConfigParser::get(const std::string &val_name) const
 {
     try
     {
@@ -37,9 +54,182 @@ json ConfigParser::get(const std::string val_name) const
         exit(EXIT_FAILURE);
     }
 }
-json ConfigParser::get() const
+const json &ConfigParser::get() const
 {
     return m_config;
 }
 
+std::string ConfigParser::get_filename() const
+{
+    return m_config_file;
+}
+
+size_t ConfigParser::get_num_trials() const
+{
+    size_t num_trials = m_repeats;
+    for (auto &group : m_sweep_groups)
+    {
+        num_trials *= group[0].values.size();
+    }
+    return num_trials;
+}
+
+ConfigParser ConfigParser::get_trial(const size_t trial_id) const
+{
+    if (trial_id >= get_num_trials())
+    {
+        std::cerr << "[ConfigParser.get_trial()] ERROR: Trial " << trial_id
+                  << " is out of range (sweep has " << get_num_trials()
+                  << " trials)" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    json config = m_config;
+    config.erase("sweep");
+    config.erase("repeats");
+
+    // Decompose the trial id into an index into each group (the last group
+    // varies fastest, after the repeats)
+    size_t remaining = trial_id / m_repeats;
+    for (size_t g = m_sweep_groups.size(); g-- > 0;)
+    {
+        const std::vector<SweepAxis> &group = m_sweep_groups[g];
+        const size_t num_values = group[0].values.size();
+        const size_t index = remaining % num_values;
+        remaining /= num_values;
+        for (auto &axis : group)
+        {
+            config[axis.name] = axis.values[index];
+        }
+    }
+
+    config["trial_id"] = trial_id;
+    // 32 bits, so it can be passed to any seeding function
+    config["seed"] = (uint32_t)splitmix64(m_base_seed ^ splitmix64(trial_id));
+    return ConfigParser(m_config_file, config);
+}
+
+ConfigParser::TrialRange ConfigParser::trials() const
+{
+    return TrialRange(this);
+}
+
+void ConfigParser::parse_sweep()
+{
+    if (m_config.count("seed") && m_config["seed"].is_number_integer())
+    {
+        m_base_seed = m_config["seed"].get<uint64_t>();
+    }
+    if (m_config.count("repeats"))
+    {
+        if (!m_config["repeats"].is_number_unsigned() ||
+            m_config["repeats"].get<size_t>() == 0)
+        {
+            std::cerr << "ERROR: \"repeats\" must be a positive integer in "
+                      << m_config_file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        m_repeats = m_config["repeats"];
+    }
+    if (!m_config.count("sweep"))
+    {
+        return;
+    }
+
+    json sweep = m_config["sweep"];
+    if (sweep.is_object())
+    {
+        // A single group doesn't need to be in a list
+        sweep = json::array({sweep});
+    }
+    if (!sweep.is_array())
+    {
+        std::cerr << "ERROR: \"sweep\" must be a list of groups of parameters in "
+                  << m_config_file << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (auto &group_spec : sweep)
+    {
+        if (!group_spec.is_object() || group_spec.size() == 0)
+        {
+            std::cerr << "ERROR: Each sweep group must be a non-empty object in "
+                      << m_config_file << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::vector<SweepAxis> group;
+        for (auto it = group_spec.begin(); it != group_spec.end(); ++it)
+        {
+            SweepAxis axis;
+            axis.name = it.key();
+            axis.values = parse_axis(it.key(), it.value());
+            if (group.size() > 0 && axis.values.size() != group[0].values.size())
+            {
+                std::cerr << "ERROR: Swept parameters '" << group[0].name
+                          << "' and '" << axis.name
+                          << "' are in the same group but have different numbers of values"
+                          << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            group.push_back(axis);
+        }
+        m_sweep_groups.push_back(group);
+    }
+}
+
+std::vector<json> ConfigParser::parse_axis(const std::string name,
+                                           const json &spec) const
+{
+    std::vector<json> values;
+    if (spec.is_array())
+    {
+        for (auto &val : spec)
+        {
+            values.push_back(val);
+        }
+    }
+    else if (spec.is_object() && spec.count("start") && spec.count("stop") &&
+             spec.count("step") && spec["start"].is_number() &&
+             spec["stop"].is_number() && spec["step"].is_number())
+    {
+        const double start = spec["start"];
+        const double stop = spec["stop"];
+        const double step = spec["step"];
+        if (step == 0 || (stop - start) / step < 0)
+        {
+            std::cerr << "ERROR: Range of swept parameter '" << name
+                      << "' never reaches its stop value" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        // Include the stop value if it's (nearly) on a step
+        const size_t count = std::floor((stop - start) / step + 1e-9) + 1;
+        const bool integer = spec["start"].is_number_integer() &&
+                             spec["step"].is_number_integer();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (integer)
+            {
+                values.push_back(spec["start"].get<int64_t>() +
+                                 (int64_t)i * spec["step"].get<int64_t>());
+            }
+            else
+            {
+                values.push_back(start + i * step);
+            }
+        }
+    }
+    else
+    {
+        std::cerr << "ERROR: Swept parameter '" << name
+                  << "' must be a list of values or a {start, stop, step} range"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (values.size() == 0)
+    {
+        std::cerr << "ERROR: Swept parameter '" << name << "' has no values"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return values;
+}
+
 } // namespace Kilosim
\ No newline at end of file
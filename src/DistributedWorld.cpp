@@ -0,0 +1,437 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/DistributedWorld.h>
+#include <kilosim/Checkpoint.h>
+
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace Kilosim
+{
+//! Tag of all messages between ranks (the communicator is private)
+static const int EXCHANGE_TAG = 0;
+
+static int comm_rank(const MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    return rank;
+}
+
+static int comm_size(const MPI_Comm comm)
+{
+    int size;
+    MPI_Comm_size(comm, &size);
+    return size;
+}
+
+//! Left edge (mm) of a rank's strip
+static double strip_edge(const double arena_width, const int rank,
+                         const int num_ranks)
+{
+    return arena_width * rank / num_ranks;
+}
+
+//! Distance (mm) that collision detection covers beyond each edge of a
+//! strip: the halo, plus a bin of padding for ghosts that move out of it
+static double collision_margin(const double halo_width)
+{
+    return halo_width + 2 * RADIUS;
+}
+
+//! Convert a byte count to the `int` MPI takes, throwing if it doesn't fit
+static int mpi_count(const uint64_t num_bytes)
+{
+    if (num_bytes > (uint64_t)INT_MAX)
+    {
+        throw std::runtime_error("DistributedWorld message of " +
+                                 std::to_string(num_bytes) +
+                                 " bytes is too large for MPI");
+    }
+    return num_bytes;
+}
+
+DistributedWorld::DistributedWorld(const double arena_width,
+                                   const double arena_height,
+                                   const RobotFactory factory,
+                                   const std::string light_pattern_src,
+                                   const uint32_t num_threads,
+                                   const double halo_width,
+                                   const MPI_Comm comm)
+    : World(arena_width, arena_height, light_pattern_src, num_threads,
+            strip_edge(arena_width, comm_rank(comm), comm_size(comm)) -
+                collision_margin(halo_width),
+            arena_width / comm_size(comm) + 2 * collision_margin(halo_width)),
+      m_halo_width(halo_width), m_factory(factory)
+{
+    if (m_halo_width < 2 * RADIUS)
+    {
+        // Otherwise collisions with robots across an edge are missed
+        throw std::runtime_error(
+            "DistributedWorld halo (" + std::to_string(m_halo_width) +
+            " mm) must be at least the collision diameter (" +
+            std::to_string(2 * RADIUS) + " mm)");
+    }
+    MPI_Comm_dup(comm, &m_comm);
+    m_rank = comm_rank(m_comm);
+    m_num_ranks = comm_size(m_comm);
+    m_left = m_rank > 0 ? m_rank - 1 : MPI_PROC_NULL;
+    m_right = m_rank < m_num_ranks - 1 ? m_rank + 1 : MPI_PROC_NULL;
+    m_x0 = strip_edge(arena_width, m_rank, m_num_ranks);
+    m_x1 = strip_edge(arena_width, m_rank + 1, m_num_ranks);
+    if (m_num_ranks > 1 && m_x1 - m_x0 < m_halo_width)
+    {
+        MPI_Comm_free(&m_comm);
+        throw std::runtime_error(
+            "DistributedWorld strips (" + std::to_string(m_x1 - m_x0) +
+            " mm) must be at least as wide as the halo (" +
+            std::to_string(m_halo_width) + " mm); use fewer ranks");
+    }
+}
+
+DistributedWorld::~DistributedWorld()
+{
+    MPI_Comm_free(&m_comm);
+}
+
+void DistributedWorld::add_robot(Robot *robot)
+{
+    m_owned_robots.emplace_back(robot);
+    World::add_robot(robot);
+}
+
+void DistributedWorld::step()
+{
+    const phase_clock::time_point step_start = start_step();
+
+    phase_clock::time_point phase_start = phase_clock::now();
+    std::vector<RobotPose> new_poses(m_robots.size());
+    find_halo();
+    end_phase(PHASE_STEP_MEMORY, phase_start);
+
+    update_light_readings();
+    run_controllers();
+    end_phase(PHASE_CONTROLLERS, phase_start);
+
+    // Every rank has the same tick, so they all exchange ghosts together
+    if (m_tick % m_comm_rate == 0)
+    {
+        exchange_ghosts();
+        communicate();
+        communicate_ghosts();
+    }
+    end_phase(PHASE_COMMUNICATE, phase_start);
+
+    compute_next_step(new_poses);
+    end_phase(PHASE_COMPUTE_NEXT_STEP, phase_start);
+
+    // Neighbors' robots near the edges are obstacles (after this rank's own)
+    exchange_ghost_poses(new_poses);
+    std::vector<int16_t> collisions(new_poses.size(), 0);
+    find_collisions(new_poses, collisions);
+    end_phase(PHASE_COLLISIONS, phase_start);
+
+    move_robots(new_poses, collisions);
+    migrate();
+    end_phase(PHASE_MOVE, phase_start);
+
+    end_step(step_start);
+}
+
+void DistributedWorld::find_halo()
+{
+    m_halo_left.clear();
+    m_halo_right.clear();
+    for (size_t i = 0; i < m_robots.size(); i++)
+    {
+        const double x = m_robots[i]->x;
+        if (m_left != MPI_PROC_NULL && x < m_x0 + m_halo_width)
+        {
+            m_halo_left.push_back(i);
+        }
+        if (m_right != MPI_PROC_NULL && x >= m_x1 - m_halo_width)
+        {
+            m_halo_right.push_back(i);
+        }
+    }
+}
+
+void DistributedWorld::exchange_ghosts()
+{
+    std::string from_left, from_right;
+    exchange(serialize_robots(m_halo_left), serialize_robots(m_halo_right),
+             from_left, from_right);
+    m_num_ghosts_left = deserialize_robots(from_left, m_ghosts, 0);
+    m_num_ghosts_right =
+        deserialize_robots(from_right, m_ghosts, m_num_ghosts_left);
+}
+
+void DistributedWorld::communicate_ghosts()
+{
+    // Number of times each ghost's message was delivered
+    std::vector<uint32_t> acks_left(m_num_ghosts_left, 0);
+    std::vector<uint32_t> acks_right(m_num_ghosts_right, 0);
+    uint64_t delivered = 0;
+    for (size_t g = 0; g < m_num_ghosts_left + m_num_ghosts_right; g++)
+    {
+        Robot &tx_r = *m_ghosts[g];
+        void *msg = tx_r.get_message();
+        if (!msg)
+        {
+            continue;
+        }
+        // Only robots within the halo can be in range of a neighbor's robot
+        const bool from_left = g < m_num_ghosts_left;
+        uint32_t &acks = from_left ? acks_left[g]
+                                   : acks_right[g - m_num_ghosts_left];
+        for (auto rx_i : from_left ? m_halo_left : m_halo_right)
+        {
+            Robot &rx_r = *m_robots[rx_i];
+            double dist = tx_r.distance(tx_r.x, tx_r.y, rx_r.x, rx_r.y);
+            if (tx_r.comm_criteria(dist) && rx_r.comm_criteria(dist))
+            {
+                rx_r.receive_msg(msg, dist);
+                acks++;
+                delivered++;
+            }
+        }
+    }
+    m_messages_delivered += delivered;
+
+    // The ghosts were sent in halo order, so the acks come back in that order
+    std::vector<uint32_t> own_acks_left, own_acks_right;
+    exchange(acks_left, acks_right, own_acks_left, own_acks_right);
+    if (own_acks_left.size() != m_halo_left.size() ||
+        own_acks_right.size() != m_halo_right.size())
+    {
+        throw std::runtime_error("DistributedWorld neighbors sent the wrong number of message acks");
+    }
+    for (size_t h = 0; h < m_halo_left.size(); h++)
+    {
+        for (uint32_t a = 0; a < own_acks_left[h]; a++)
+        {
+            m_robots[m_halo_left[h]]->received();
+        }
+    }
+    for (size_t h = 0; h < m_halo_right.size(); h++)
+    {
+        for (uint32_t a = 0; a < own_acks_right[h]; a++)
+        {
+            m_robots[m_halo_right[h]]->received();
+        }
+    }
+}
+
+void DistributedWorld::exchange_ghost_poses(std::vector<RobotPose> &new_poses)
+{
+    std::vector<RobotPose> to_left, to_right, from_left, from_right;
+    for (auto i : m_halo_left)
+    {
+        to_left.push_back(new_poses[i]);
+    }
+    for (auto i : m_halo_right)
+    {
+        to_right.push_back(new_poses[i]);
+    }
+    exchange(to_left, to_right, from_left, from_right);
+    new_poses.insert(new_poses.end(), from_left.begin(), from_left.end());
+    new_poses.insert(new_poses.end(), from_right.begin(), from_right.end());
+}
+
+void DistributedWorld::migrate()
+{
+    std::vector<size_t> to_left, to_right;
+    for (size_t i = 0; i < m_robots.size(); i++)
+    {
+        const double x = m_robots[i]->x;
+        if (m_left != MPI_PROC_NULL && x < m_x0)
+        {
+            to_left.push_back(i);
+        }
+        else if (m_right != MPI_PROC_NULL && x >= m_x1)
+        {
+            to_right.push_back(i);
+        }
+    }
+    std::string from_left, from_right;
+    exchange(serialize_robots(to_left), serialize_robots(to_right),
+             from_left, from_right);
+
+    if (to_left.size() + to_right.size() > 0)
+    {
+        // Remove (and delete) the robots that left
+        std::unordered_set<Robot *> departed;
+        for (auto i : to_left)
+        {
+            departed.insert(m_robots[i]);
+        }
+        for (auto i : to_right)
+        {
+            departed.insert(m_robots[i]);
+        }
+        std::vector<Robot *> remaining;
+        remaining.reserve(m_robots.size() - departed.size());
+        for (auto r : m_robots)
+        {
+            if (departed.count(r) == 0)
+            {
+                remaining.push_back(r);
+            }
+        }
+        m_robots.swap(remaining);
+        std::vector<std::unique_ptr<Robot>> owned;
+        for (auto &r : m_owned_robots)
+        {
+            if (departed.count(r.get()) == 0)
+            {
+                owned.push_back(std::move(r));
+            }
+        }
+        m_owned_robots.swap(owned);
+    }
+
+    std::vector<std::unique_ptr<Robot>> arrived;
+    const size_t num_left = deserialize_robots(from_left, arrived, 0);
+    deserialize_robots(from_right, arrived, num_left);
+    for (auto &r : arrived)
+    {
+        add_robot(r.release());
+    }
+}
+
+std::string DistributedWorld::serialize_robots(const std::vector<size_t> &indices) const
+{
+    std::ostringstream out;
+    checkpoint_write(out, (uint64_t)indices.size());
+    for (auto i : indices)
+    {
+        // Each Robot is saved with its size so mismatched Robots are detected
+        std::ostringstream robot_out;
+        m_robots[i]->save_checkpoint(robot_out);
+        checkpoint_write(out, robot_out.str());
+    }
+    return out.str();
+}
+
+size_t DistributedWorld::deserialize_robots(const std::string &data,
+                                            std::vector<std::unique_ptr<Robot>> &robots,
+                                            const size_t start)
+{
+    if (data.empty())
+    {
+        // No neighbor
+        return 0;
+    }
+    std::istringstream in(data);
+    uint64_t num_robots;
+    checkpoint_read(in, num_robots);
+    if (robots.size() < start + num_robots)
+    {
+        robots.resize(start + num_robots);
+    }
+    std::string robot_state;
+    for (size_t i = start; i < start + num_robots; i++)
+    {
+        if (!robots[i])
+        {
+            robots[i].reset(m_factory());
+            attach_robot(robots[i].get());
+        }
+        checkpoint_read(in, robot_state);
+        std::istringstream robot_in(robot_state);
+        robots[i]->load_checkpoint(robot_in);
+        if (robot_in.peek() != std::char_traits<char>::eof())
+            throw std::runtime_error("DistributedWorld robot state doesn't match the RobotFactory's robots");
+    }
+    return num_robots;
+}
+
+template <class Buffer>
+void DistributedWorld::exchange(const Buffer &to_left, const Buffer &to_right,
+                                Buffer &from_left, Buffer &from_right) const
+{
+    typedef typename Buffer::value_type T;
+    // Sizes first, so the buffers can be allocated. Sending to/receiving from
+    // MPI_PROC_NULL (no neighbor) does nothing.
+    uint64_t to_sizes[2] = {to_left.size(), to_right.size()};
+    uint64_t from_left_size = 0;
+    uint64_t from_right_size = 0;
+    MPI_Sendrecv(&to_sizes[0], 1, MPI_UINT64_T, m_left, EXCHANGE_TAG,
+                 &from_right_size, 1, MPI_UINT64_T, m_right, EXCHANGE_TAG,
+                 m_comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&to_sizes[1], 1, MPI_UINT64_T, m_right, EXCHANGE_TAG,
+                 &from_left_size, 1, MPI_UINT64_T, m_left, EXCHANGE_TAG,
+                 m_comm, MPI_STATUS_IGNORE);
+
+    from_left.resize(from_left_size);
+    from_right.resize(from_right_size);
+    T *from_left_data = from_left_size > 0 ? &from_left[0] : nullptr;
+    T *from_right_data = from_right_size > 0 ? &from_right[0] : nullptr;
+    MPI_Sendrecv(to_left.data(), mpi_count(to_left.size() * sizeof(T)),
+                 MPI_BYTE, m_left, EXCHANGE_TAG, from_right_data,
+                 mpi_count(from_right_size * sizeof(T)), MPI_BYTE, m_right,
+                 EXCHANGE_TAG, m_comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(to_right.data(), mpi_count(to_right.size() * sizeof(T)),
+                 MPI_BYTE, m_right, EXCHANGE_TAG, from_left_data,
+                 mpi_count(from_left_size * sizeof(T)), MPI_BYTE, m_left,
+                 EXCHANGE_TAG, m_comm, MPI_STATUS_IGNORE);
+}
+
+bool DistributedWorld::in_domain(const double x) const
+{
+    // The outer strips also hold anything beyond the arena's walls
+    return (m_left == MPI_PROC_NULL || x >= m_x0) &&
+           (m_right == MPI_PROC_NULL || x < m_x1);
+}
+
+int DistributedWorld::get_rank() const
+{
+    return m_rank;
+}
+
+int DistributedWorld::get_num_ranks() const
+{
+    return m_num_ranks;
+}
+
+uint64_t DistributedWorld::get_total_robots() const
+{
+    uint64_t num_robots = m_robots.size();
+    uint64_t total = 0;
+    MPI_Allreduce(&num_robots, &total, 1, MPI_UINT64_T, MPI_SUM, m_comm);
+    return total;
+}
+
+std::vector<RobotPose> DistributedWorld::gather_poses(const int root) const
+{
+    std::vector<RobotPose> poses;
+    for (auto &r : m_robots)
+    {
+        poses.push_back(RobotPose(r->x, r->y, r->theta));
+    }
+    const int num_bytes = mpi_count(poses.size() * sizeof(RobotPose));
+    std::vector<int> counts(m_num_ranks, 0);
+    MPI_Gather(&num_bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, root, m_comm);
+
+    std::vector<int> offsets(m_num_ranks, 0);
+    for (int r = 1; r < m_num_ranks; r++)
+    {
+        // Offsets are ints too, so the total must also fit
+        offsets[r] = mpi_count((uint64_t)offsets[r - 1] + counts[r - 1]);
+    }
+    std::vector<RobotPose> all_poses;
+    if (m_rank == root)
+    {
+        all_poses.resize((offsets.back() + counts.back()) / sizeof(RobotPose));
+    }
+    MPI_Gatherv(poses.data(), num_bytes, MPI_BYTE, all_poses.data(),
+                counts.data(), offsets.data(), MPI_BYTE, root, m_comm);
+    return all_poses;
+}
+} // namespace Kilosim
@@ -0,0 +1,269 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/FrameStream.h>
+
+#include <H5Cpp.h>
+#include <H5PacketTable.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace Kilosim
+{
+//! Number of frames the file grows by when it runs out of space (at least)
+static const uint64_t FRAME_STREAM_GROWTH = 1024;
+
+FrameStreamWriter::FrameStreamWriter(World &world, const std::string filename)
+    : m_world(world), m_file(filename, true)
+{
+    m_num_robots = world.get_robots().size();
+    m_frame_size = sizeof(double) + m_num_robots * sizeof(FrameRobotState);
+
+    m_file.resize(sizeof(FrameStreamHeader) +
+                  FRAME_STREAM_GROWTH * m_frame_size);
+    FrameStreamHeader *h = header();
+    std::memset(h, 0, sizeof(FrameStreamHeader));
+    std::memcpy(h->magic, FRAME_STREAM_MAGIC, sizeof(h->magic));
+    h->version = FRAME_STREAM_VERSION;
+    h->header_size = sizeof(FrameStreamHeader);
+    h->num_robots = m_num_robots;
+    h->frame_size = m_frame_size;
+    h->num_frames = 0;
+    std::vector<double> dim = world.get_dimensions();
+    h->arena_width = dim[0];
+    h->arena_height = dim[1];
+    h->tick_rate = world.get_tick_rate();
+}
+
+FrameStreamWriter::~FrameStreamWriter()
+{
+    // Drop the unused space at the end of the file
+    try
+    {
+        m_file.resize(sizeof(FrameStreamHeader) + m_num_frames * m_frame_size);
+    }
+    catch (const std::runtime_error &err)
+    {
+        fprintf(stderr, "WARNING: %s\n", err.what());
+    }
+}
+
+void FrameStreamWriter::log_state()
+{
+    const size_t needed = sizeof(FrameStreamHeader) +
+                          (m_num_frames + 1) * m_frame_size;
+    if (needed > m_file.size())
+    {
+        // Grow geometrically so remapping stays rare
+        const uint64_t capacity =
+            std::max(2 * m_num_frames, m_num_frames + FRAME_STREAM_GROWTH);
+        m_file.resize(sizeof(FrameStreamHeader) + capacity * m_frame_size);
+    }
+
+    std::vector<Robot *> &robots = m_world.get_robots();
+    if (robots.size() != m_num_robots)
+    {
+        fprintf(stderr, "WARNING: Number of robots changed since frame stream was created\n");
+    }
+
+    char *frame = m_file.data() + sizeof(FrameStreamHeader) +
+                  m_num_frames * m_frame_size;
+    const double t = m_world.get_time();
+    std::memcpy(frame, &t, sizeof(double));
+    FrameRobotState *states = (FrameRobotState *)(frame + sizeof(double));
+    const size_t n = std::min(robots.size(), (size_t)m_num_robots);
+    for (size_t i = 0; i < n; i++)
+    {
+        const Robot &r = *robots[i];
+        states[i].x = r.x;
+        states[i].y = r.y;
+        states[i].theta = r.theta;
+        for (int c = 0; c < 3; c++)
+        {
+            states[i].color[c] = r.color[c];
+        }
+    }
+    for (size_t i = n; i < m_num_robots; i++)
+    {
+        states[i] = FrameRobotState();
+    }
+
+    // Only count the frame once it's completely written
+    m_num_frames++;
+    header()->num_frames = m_num_frames;
+}
+
+uint64_t FrameStreamWriter::get_num_frames() const
+{
+    return m_num_frames;
+}
+
+FrameStreamHeader *FrameStreamWriter::header()
+{
+    return (FrameStreamHeader *)m_file.data();
+}
+
+FrameStreamReader::FrameStreamReader(const std::string filename)
+    : m_file(filename, false)
+{
+    if (m_file.size() < sizeof(FrameStreamHeader) ||
+        std::memcmp(header().magic, FRAME_STREAM_MAGIC,
+                    sizeof(FRAME_STREAM_MAGIC)) != 0)
+    {
+        throw std::runtime_error(filename + " is not a Kilosim frame stream");
+    }
+    if (header().version != FRAME_STREAM_VERSION || header().frame_size == 0)
+    {
+        throw std::runtime_error(filename + " has an unsupported frame stream version");
+    }
+    // Frames must start inside the file and hold every robot, or frame
+    // pointers would point past the end of the mapping
+    if (header().header_size < sizeof(FrameStreamHeader) ||
+        header().header_size > m_file.size() ||
+        header().frame_size != sizeof(double) + (uint64_t)header().num_robots *
+                                                    sizeof(FrameRobotState))
+    {
+        throw std::runtime_error(filename + " has a corrupt frame stream header");
+    }
+    // The file may still be being written (or was not closed cleanly), so
+    // only trust frames that are fully in the file
+    const uint64_t frames_in_file =
+        (m_file.size() - header().header_size) / header().frame_size;
+    m_num_frames = std::min(header().num_frames, frames_in_file);
+}
+
+const FrameStreamHeader &FrameStreamReader::header() const
+{
+    return *(const FrameStreamHeader *)m_file.data();
+}
+
+uint64_t FrameStreamReader::get_num_frames() const
+{
+    return m_num_frames;
+}
+
+double FrameStreamReader::get_time(const uint64_t frame) const
+{
+    double t;
+    std::memcpy(&t, frame_start(frame), sizeof(double));
+    return t;
+}
+
+const FrameRobotState *FrameStreamReader::get_robots(const uint64_t frame) const
+{
+    return (const FrameRobotState *)(frame_start(frame) + sizeof(double));
+}
+
+const char *FrameStreamReader::frame_start(const uint64_t frame) const
+{
+    if (frame >= m_num_frames)
+    {
+        throw std::out_of_range("Frame index out of range");
+    }
+    return m_file.data() + header().header_size + frame * header().frame_size;
+}
+
+void frame_stream_to_h5(const std::string stream_file,
+                        const std::string h5_file, const int trial_num,
+                        const bool overwrite_trial)
+{
+    FrameStreamReader reader(stream_file);
+    const hsize_t n = reader.header().num_robots;
+
+    H5::Exception::dontPrint();
+    std::unique_ptr<H5::H5File> file_ptr;
+    // Only create the file if there isn't one, so a file that can't be
+    // opened as HDF5 (e.g., a mistyped path to other data) isn't wiped
+    struct stat file_stat;
+    const bool exists = stat(h5_file.c_str(), &file_stat) == 0;
+    try
+    {
+        file_ptr.reset(new H5::H5File(h5_file.c_str(),
+                                      exists ? H5F_ACC_RDWR : H5F_ACC_EXCL));
+    }
+    catch (const H5::FileIException &)
+    {
+        throw std::runtime_error(
+            "Failed to " + std::string(exists ? "open " : "create ") + h5_file +
+            (exists ? " (it must be a writable HDF5 file)" : ""));
+    }
+    H5::H5File &file = *file_ptr;
+
+    const std::string group_name = "trial_" + std::to_string(trial_num);
+    if (H5Lexists(file.getId(), group_name.c_str(), H5P_DEFAULT) > 0)
+    {
+        if (!overwrite_trial)
+        {
+            throw std::runtime_error(group_name + " already exists in " + h5_file);
+        }
+        file.unlink(group_name.c_str());
+    }
+    file.createGroup(group_name.c_str());
+
+    // Same types as the Logger's time series and per-robot aggregators
+    hsize_t robot_dims[1] = {n};
+    H5::ArrayType robot_type(H5::PredType::NATIVE_DOUBLE, 1, robot_dims);
+    hsize_t color_dims[2] = {n, 3};
+    H5::ArrayType color_type(H5::PredType::NATIVE_DOUBLE, 2, color_dims);
+    const hsize_t chunk_size = 64;
+    FL_PacketTable time_table(file.getId(), (group_name + "/time").c_str(),
+                              H5T_NATIVE_DOUBLE, chunk_size);
+    FL_PacketTable x_table(file.getId(), (group_name + "/x").c_str(),
+                           robot_type.getId(), chunk_size);
+    FL_PacketTable y_table(file.getId(), (group_name + "/y").c_str(),
+                           robot_type.getId(), chunk_size);
+    FL_PacketTable theta_table(file.getId(), (group_name + "/theta").c_str(),
+                               robot_type.getId(), chunk_size);
+    FL_PacketTable color_table(file.getId(), (group_name + "/color").c_str(),
+                               color_type.getId(), chunk_size);
+    if (!time_table.IsValid() || !x_table.IsValid() || !y_table.IsValid() ||
+        !theta_table.IsValid() || !color_table.IsValid())
+    {
+        throw std::runtime_error("Failed to create datasets in " + h5_file);
+    }
+
+    // Transpose the frames into the per-field datasets in batches
+    const uint64_t batch_size = 256;
+    std::vector<double> times(batch_size);
+    std::vector<double> xs(batch_size * n);
+    std::vector<double> ys(batch_size * n);
+    std::vector<double> thetas(batch_size * n);
+    std::vector<double> colors(batch_size * n * 3);
+    for (uint64_t start = 0; start < reader.get_num_frames(); start += batch_size)
+    {
+        const uint64_t count =
+            std::min(batch_size, reader.get_num_frames() - start);
+        for (uint64_t f = 0; f < count; f++)
+        {
+            times[f] = reader.get_time(start + f);
+            const FrameRobotState *states = reader.get_robots(start + f);
+            for (hsize_t i = 0; i < n; i++)
+            {
+                xs[f * n + i] = states[i].x;
+                ys[f * n + i] = states[i].y;
+                thetas[f * n + i] = states[i].theta;
+                for (int c = 0; c < 3; c++)
+                {
+                    colors[(f * n + i) * 3 + c] = states[i].color[c];
+                }
+            }
+        }
+        if (time_table.AppendPackets(count, times.data()) < 0 ||
+            x_table.AppendPackets(count, xs.data()) < 0 ||
+            y_table.AppendPackets(count, ys.data()) < 0 ||
+            theta_table.AppendPackets(count, thetas.data()) < 0 ||
+            color_table.AppendPackets(count, colors.data()) < 0)
+        {
+            throw std::runtime_error("Failed to write frames to " + h5_file);
+        }
+    }
+}
+} // namespace Kilosim
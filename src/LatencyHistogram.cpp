@@ -0,0 +1,100 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/LatencyHistogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Kilosim
+{
+constexpr uint32_t LatencyHistogram::SUB_BUCKET_BITS;
+constexpr uint32_t LatencyHistogram::MAX_EXPONENT;
+constexpr uint32_t LatencyHistogram::SUB_BUCKETS;
+constexpr uint32_t LatencyHistogram::NUM_BUCKETS;
+
+LatencyHistogram::LatencyHistogram() noexcept
+{
+    m_counts.fill(0);
+}
+
+void LatencyHistogram::reset() noexcept
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_total = 0;
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::get_count() const noexcept
+{
+    return m_count;
+}
+
+double LatencyHistogram::get_total() const noexcept
+{
+    return m_total * 1e-9;
+}
+
+double LatencyHistogram::get_mean() const noexcept
+{
+    return m_count > 0 ? get_total() / m_count : 0;
+}
+
+double LatencyHistogram::get_max() const noexcept
+{
+    return m_max * 1e-9;
+}
+
+double LatencyHistogram::get_percentile(const double percentile) const noexcept
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    // Number of durations at or below the percentile (at least 1)
+    const double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100;
+    const uint64_t rank = std::max((uint64_t)std::ceil(fraction * m_count), (uint64_t)1);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            return std::min(bucket_upper(i), m_max) * 1e-9;
+        }
+    }
+    return get_max();
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) noexcept
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        m_counts[i] += other.m_counts[i];
+    }
+    m_count += other.m_count;
+    m_total += other.m_total;
+    m_max = std::max(m_max, other.m_max);
+}
+
+uint64_t LatencyHistogram::bucket_upper(const uint32_t index) noexcept
+{
+    if (index < 2 * SUB_BUCKETS)
+    {
+        // Buckets below 2^(SUB_BUCKET_BITS + 1) ns are 1 ns wide
+        return index;
+    }
+    if (index == NUM_BUCKETS - 1)
+    {
+        // Also holds everything too long for the other buckets
+        return UINT64_MAX;
+    }
+    const uint32_t shift = index / SUB_BUCKETS - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+} // namespace Kilosim
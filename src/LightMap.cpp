@@ -0,0 +1,388 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/LightMap.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace Kilosim
+{
+//! Multiply sizes, returning false (instead of wrapping) if it overflows
+static bool checked_mul(const uint64_t a, const uint64_t b, uint64_t &product)
+{
+    if (a != 0 && b > UINT64_MAX / a)
+    {
+        return false;
+    }
+    product = a * b;
+    return true;
+}
+
+LightMap::LightMap(const std::string filename, const bool memory_map)
+    : m_filename(filename), m_num_loaded(0)
+{
+    uint64_t file_size;
+    if (memory_map)
+    {
+        m_file.reset(new MappedFile(filename, false));
+        file_size = m_file->size();
+    }
+    else
+    {
+        m_fd = open(filename.c_str(), O_RDONLY);
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Failed to open " + filename + ": " +
+                                     std::strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(m_fd, &file_stat) != 0)
+        {
+            close(m_fd);
+            throw std::runtime_error("Failed to stat " + filename);
+        }
+        file_size = file_stat.st_size;
+    }
+    try
+    {
+        load_layout(file_size);
+    }
+    catch (const std::runtime_error &)
+    {
+        // The destructor won't run if the constructor throws
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+        }
+        throw;
+    }
+}
+
+void LightMap::load_layout(const uint64_t file_size)
+{
+    LightMapHeader header;
+    if (file_size < sizeof(LightMapHeader))
+    {
+        throw std::runtime_error(m_filename + " is not a Kilosim light map");
+    }
+    read_bytes(&header, sizeof(LightMapHeader), 0);
+    if (std::memcmp(header.magic, LIGHT_MAP_MAGIC, sizeof(LIGHT_MAP_MAGIC)) != 0)
+    {
+        throw std::runtime_error(m_filename + " is not a Kilosim light map");
+    }
+    if (header.version != LIGHT_MAP_VERSION || header.tile_size == 0 ||
+        header.num_levels == 0)
+    {
+        throw std::runtime_error(m_filename + " has an unsupported light map version");
+    }
+    m_tile_size = header.tile_size;
+
+    const uint64_t table_size =
+        (uint64_t)header.num_levels * sizeof(LightMapLevel);
+    if (file_size < sizeof(LightMapHeader) + table_size)
+    {
+        throw std::runtime_error(m_filename + " is truncated");
+    }
+    m_levels.resize(header.num_levels);
+    read_bytes(m_levels.data(), table_size, sizeof(LightMapHeader));
+
+    // Check every level's tiles cover it and fit in the file now, rather than
+    // reading out of bounds (or failing) when one of its tiles is first read.
+    // Sizes come from the file, so they're checked for overflow.
+    uint64_t tile_bytes;
+    if (!checked_mul((uint64_t)m_tile_size * m_tile_size, sizeof(uint16_t),
+                     tile_bytes))
+    {
+        throw std::runtime_error(m_filename + " has a corrupt level table");
+    }
+    for (auto &level : m_levels)
+    {
+        const uint64_t num_tiles = (uint64_t)level.tiles_x * level.tiles_y;
+        uint64_t level_bytes;
+        if (level.width == 0 || level.height == 0 ||
+            level.width > (uint64_t)level.tiles_x * m_tile_size ||
+            level.height > (uint64_t)level.tiles_y * m_tile_size ||
+            !checked_mul(num_tiles, tile_bytes, level_bytes))
+        {
+            throw std::runtime_error(m_filename + " has a corrupt level table");
+        }
+        if (level.offset > file_size || level_bytes > file_size - level.offset)
+        {
+            throw std::runtime_error(m_filename + " is truncated");
+        }
+        m_level_first_tile.push_back(m_num_tiles);
+        m_num_tiles += num_tiles;
+    }
+    if (!m_file)
+    {
+        m_tiles.reset(new std::atomic<uint16_t *>[m_num_tiles]);
+        for (size_t i = 0; i < m_num_tiles; i++)
+        {
+            m_tiles[i] = nullptr;
+        }
+    }
+}
+
+LightMap::~LightMap()
+{
+    if (m_tiles)
+    {
+        for (size_t i = 0; i < m_num_tiles; i++)
+        {
+            delete[] m_tiles[i].load();
+        }
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+uint32_t LightMap::get_num_levels() const
+{
+    return m_levels.size();
+}
+
+uint32_t LightMap::get_width(const uint32_t level) const
+{
+    return m_levels[level].width;
+}
+
+uint32_t LightMap::get_height(const uint32_t level) const
+{
+    return m_levels[level].height;
+}
+
+uint16_t LightMap::get_texel(const uint32_t level, const uint32_t x,
+                             const uint32_t y) const
+{
+    const uint16_t *tile = get_tile(level, x / m_tile_size, y / m_tile_size);
+    return tile[(y % m_tile_size) * m_tile_size + (x % m_tile_size)];
+}
+
+double LightMap::sample(const uint32_t level, const double u,
+                        const double v) const
+{
+    const LightMapLevel &l = m_levels[level];
+    // Interpolate between texel centers, clamping at the edges
+    const double fu = std::min(std::max(u - 0.5, 0.0), l.width - 1.0);
+    const double fv = std::min(std::max(v - 0.5, 0.0), l.height - 1.0);
+    const uint32_t x0 = fu;
+    const uint32_t y0 = fv;
+    const uint32_t x1 = std::min(x0 + 1, l.width - 1);
+    const uint32_t y1 = std::min(y0 + 1, l.height - 1);
+    const double tu = fu - x0;
+    const double tv = fv - y0;
+    const double bottom = (1 - tu) * get_texel(level, x0, y0) +
+                          tu * get_texel(level, x1, y0);
+    const double top = (1 - tu) * get_texel(level, x0, y1) +
+                       tu * get_texel(level, x1, y1);
+    return (1 - tv) * bottom + tv * top;
+}
+
+sf::Image LightMap::get_image(const uint32_t level) const
+{
+    const LightMapLevel &l = m_levels[level];
+    sf::Image img;
+    img.create(l.width, l.height);
+    for (uint32_t y = 0; y < l.height; y++)
+    {
+        for (uint32_t x = 0; x < l.width; x++)
+        {
+            const sf::Uint8 gray = get_texel(level, x, y) / 4;
+            // Flip the y-axis back to image orientation
+            img.setPixel(x, l.height - y - 1, sf::Color(gray, gray, gray));
+        }
+    }
+    return img;
+}
+
+size_t LightMap::get_num_loaded_tiles() const
+{
+    return m_num_loaded;
+}
+
+const uint16_t *LightMap::get_tile(const uint32_t level, const uint32_t tile_x,
+                                   const uint32_t tile_y) const
+{
+    const LightMapLevel &l = m_levels[level];
+    const size_t tile_index = (size_t)tile_y * l.tiles_x + tile_x;
+    const size_t tile_texels = (size_t)m_tile_size * m_tile_size;
+    const uint64_t offset = l.offset + tile_index * tile_texels * sizeof(uint16_t);
+    if (m_file)
+    {
+        // Paged in by the OS the first time it's touched
+        return (const uint16_t *)(m_file->data() + offset);
+    }
+
+    std::atomic<uint16_t *> &slot = m_tiles[m_level_first_tile[level] + tile_index];
+    uint16_t *tile = slot.load(std::memory_order_acquire);
+    if (tile)
+    {
+        return tile;
+    }
+    // If threads read the same tile at once, the first one to finish keeps
+    // its copy and the others discard theirs
+    std::unique_ptr<uint16_t[]> loaded(new uint16_t[tile_texels]);
+    read_at(loaded.get(), tile_texels * sizeof(uint16_t), offset);
+    uint16_t *expected = nullptr;
+    if (slot.compare_exchange_strong(expected, loaded.get(),
+                                     std::memory_order_acq_rel))
+    {
+        m_num_loaded++;
+        return loaded.release();
+    }
+    return expected;
+}
+
+void LightMap::read_bytes(void *dest, const size_t size,
+                          const uint64_t offset) const
+{
+    if (m_file)
+    {
+        std::memcpy(dest, m_file->data() + offset, size);
+    }
+    else
+    {
+        read_at(dest, size, offset);
+    }
+}
+
+void LightMap::read_at(void *dest, const size_t size,
+                       const uint64_t offset) const
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n = pread(m_fd, (char *)dest + done, size - done,
+                                offset + done);
+        if (n <= 0)
+        {
+            throw std::runtime_error("Failed to read " + m_filename);
+        }
+        done += n;
+    }
+}
+
+void build_light_map(const std::string img_src, const std::string map_file,
+                     const uint32_t tile_size)
+{
+    if (tile_size == 0)
+    {
+        throw std::runtime_error("Light map tile size must be positive");
+    }
+    sf::Image img;
+    if (!img.loadFromFile(img_src))
+    {
+        throw std::runtime_error("Failed to load light map image " + img_src);
+    }
+
+    // Full-resolution level, with the same conversion as LightPattern
+    std::vector<std::vector<uint16_t>> levels(1);
+    std::vector<LightMapLevel> layout(1);
+    layout[0].width = img.getSize().x;
+    layout[0].height = img.getSize().y;
+    levels[0].resize(layout[0].width * layout[0].height);
+    const sf::Uint8 *pixels = img.getPixelsPtr();
+    for (uint32_t y = 0; y < layout[0].height; y++)
+    {
+        // Flip the y-axis, so row 0 is the bottom of the World
+        const sf::Uint8 *row = pixels + 4 * (layout[0].height - y - 1) * layout[0].width;
+        for (uint32_t x = 0; x < layout[0].width; x++)
+        {
+            const sf::Uint8 *c = row + 4 * x;
+            double luminosity = (0.3 * c[0]) + (0.59 * c[1]) + (0.11 * c[2]);
+            levels[0][y * layout[0].width + x] = (uint16_t)luminosity * 4;
+        }
+    }
+
+    // Halve the resolution until a level fits in one tile
+    while (layout.back().width > tile_size || layout.back().height > tile_size)
+    {
+        const LightMapLevel &prev = layout.back();
+        const std::vector<uint16_t> &src = levels.back();
+        LightMapLevel next;
+        next.width = std::max(1u, (prev.width + 1) / 2);
+        next.height = std::max(1u, (prev.height + 1) / 2);
+        std::vector<uint16_t> dst(next.width * next.height);
+        for (uint32_t y = 0; y < next.height; y++)
+        {
+            for (uint32_t x = 0; x < next.width; x++)
+            {
+                // Average the (up to) 2x2 texels covered
+                uint32_t sum = 0;
+                uint32_t count = 0;
+                for (uint32_t sy = 2 * y; sy < std::min(2 * y + 2, prev.height); sy++)
+                {
+                    for (uint32_t sx = 2 * x; sx < std::min(2 * x + 2, prev.width); sx++)
+                    {
+                        sum += src[sy * prev.width + sx];
+                        count++;
+                    }
+                }
+                dst[y * next.width + x] = (sum + count / 2) / count;
+            }
+        }
+        layout.push_back(next);
+        levels.push_back(std::move(dst));
+    }
+
+    // Lay out the tiles of every level after the header and level table
+    const size_t tile_texels = tile_size * tile_size;
+    uint64_t offset = sizeof(LightMapHeader) + layout.size() * sizeof(LightMapLevel);
+    for (auto &l : layout)
+    {
+        l.tiles_x = (l.width + tile_size - 1) / tile_size;
+        l.tiles_y = (l.height + tile_size - 1) / tile_size;
+        l.offset = offset;
+        offset += (uint64_t)l.tiles_x * l.tiles_y * tile_texels * sizeof(uint16_t);
+    }
+
+    MappedFile file(map_file, true);
+    file.resize(offset);
+    LightMapHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LIGHT_MAP_MAGIC, sizeof(header.magic));
+    header.version = LIGHT_MAP_VERSION;
+    header.tile_size = tile_size;
+    header.num_levels = layout.size();
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(file.data() + sizeof(header), layout.data(),
+                layout.size() * sizeof(LightMapLevel));
+
+    for (size_t i = 0; i < layout.size(); i++)
+    {
+        const LightMapLevel &l = layout[i];
+        uint16_t *tiles = (uint16_t *)(file.data() + l.offset);
+        for (uint32_t ty = 0; ty < l.tiles_y; ty++)
+        {
+            for (uint32_t tx = 0; tx < l.tiles_x; tx++)
+            {
+                uint16_t *tile = tiles + (ty * l.tiles_x + tx) * tile_texels;
+                for (uint32_t y = 0; y < tile_size; y++)
+                {
+                    for (uint32_t x = 0; x < tile_size; x++)
+                    {
+                        // Partial tiles at the edges repeat the edge texels
+                        const uint32_t src_x = std::min(tx * tile_size + x, l.width - 1);
+                        const uint32_t src_y = std::min(ty * tile_size + y, l.height - 1);
+                        tile[y * tile_size + x] = levels[i][src_y * l.width + src_x];
+                    }
+                }
+            }
+        }
+    }
+}
+} // namespace Kilosim
@@ -6,13 +6,192 @@
 
 #include <kilosim/LightPattern.h>
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
 namespace Kilosim
 {
+//! Largest width of the light map level used for get_light_pattern
+static const uint32_t LIGHT_MAP_IMAGE_WIDTH = 1024;
+
+//! Load an image file and precompute its light intensity (exits on failure)
+static std::shared_ptr<const LightFrame> load_frame(const std::string img_src)
+{
+    std::shared_ptr<LightFrame> frame = std::make_shared<LightFrame>();
+    if (!frame->image.loadFromFile(img_src))
+    {
+        exit(EXIT_FAILURE);
+    }
+    const sf::Vector2u dim = frame->image.getSize();
+    frame->luminance.resize(dim.x * dim.y);
+    const sf::Uint8 *pixels = frame->image.getPixelsPtr();
+    for (uint32_t y_in_img = 0; y_in_img < dim.y; y_in_img++)
+    {
+        // Flip the y-axis, so row 0 is the bottom of the World
+        const sf::Uint8 *row = pixels + 4 * (dim.y - y_in_img - 1) * dim.x;
+        for (uint32_t x_in_img = 0; x_in_img < dim.x; x_in_img++)
+        {
+            const sf::Uint8 *c = row + 4 * x_in_img;
+            // Convert the color from RGB to grayscale using approximate
+            // luminosity. Each value is 8-bit, so the resulting value is in
+            // the scale [0-255]
+            double luminosity = (0.3 * c[0]) + (0.59 * c[1]) + (0.11 * c[2]);
+            // Scale to 10-bit [0-1023]
+            frame->luminance[y_in_img * dim.x + x_in_img] =
+                (uint16_t)luminosity * 4;
+        }
+    }
+    return frame;
+}
+
+/*!
+ * Loads the frames of a streamed sequence on a background thread, one frame
+ * ahead of the frame that was last taken
+ */
+class LightPattern::FramePrefetcher
+{
+private:
+    //! Image files of the sequence
+    const std::vector<std::string> m_srcs;
+    //! Whether the sequence loops (otherwise it stops at the last frame)
+    const bool m_loop;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Index of the frame that should be loaded
+    size_t m_requested;
+    //! Index of the frame in m_loaded (or m_srcs.size() if none)
+    size_t m_loaded_index;
+    //! Most recently loaded frame
+    std::shared_ptr<const LightFrame> m_loaded;
+    //! Tells the thread to stop
+    bool m_stop = false;
+    std::thread m_thread;
+
+public:
+    FramePrefetcher(const std::vector<std::string> srcs, const bool loop,
+                    const size_t first)
+        : m_srcs(srcs), m_loop(loop), m_requested(first),
+          m_loaded_index(srcs.size())
+    {
+        m_thread = std::thread(&FramePrefetcher::run, this);
+    }
+
+    ~FramePrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    //! Get a frame (waiting for it to load if needed) and start loading the
+    //! frame after it
+    std::shared_ptr<const LightFrame> get(const size_t index)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_loaded_index != index && m_requested != index)
+        {
+            // Jumped to a different frame than was prefetched
+            m_requested = index;
+            m_cv.notify_all();
+        }
+        m_cv.wait(lock, [&] { return m_loaded_index == index; });
+        std::shared_ptr<const LightFrame> frame = m_loaded;
+
+        size_t next = index + 1;
+        if (next >= m_srcs.size())
+        {
+            next = m_loop ? 0 : index;
+        }
+        m_requested = next;
+        m_cv.notify_all();
+        return frame;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(lock, [&] { return m_stop || m_requested != m_loaded_index; });
+            if (m_stop)
+            {
+                return;
+            }
+            const size_t index = m_requested;
+            lock.unlock();
+            // Decode without holding the lock
+            std::shared_ptr<const LightFrame> frame = load_frame(m_srcs[index]);
+            lock.lock();
+            if (m_requested == index)
+            {
+                m_loaded = frame;
+                m_loaded_index = index;
+                m_cv.notify_all();
+            }
+        }
+    }
+};
+
 LightPattern::LightPattern()
 {
     m_has_source = false;
 };
 
+LightPattern::LightPattern(const LightPattern &other)
+{
+    *this = other;
+}
+
+LightPattern &LightPattern::operator=(const LightPattern &other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    clear_dynamic();
+    m_frame = other.m_frame;
+    m_arena_width = other.m_arena_width;
+    m_img_dim = other.m_img_dim;
+    m_scale = other.m_scale;
+    m_has_source = other.m_has_source;
+    m_version = other.m_version;
+    m_mode = other.m_mode;
+    m_time = other.m_time;
+    m_frame_srcs = other.m_frame_srcs;
+    m_frames = other.m_frames;
+    m_frame_duration = other.m_frame_duration;
+    m_sequence_start = other.m_sequence_start;
+    m_loop = other.m_loop;
+    m_frame_index = other.m_frame_index;
+    m_light_func = other.m_light_func;
+    m_arena_height = other.m_arena_height;
+    m_func_resolution = other.m_func_resolution;
+    m_update_period = other.m_update_period;
+    m_func_step = other.m_func_step;
+    m_light_map = other.m_light_map;
+    m_map_level = other.m_map_level;
+    m_map_scale = other.m_map_scale;
+    if (m_mode == Mode::STREAMED_SEQUENCE)
+    {
+        // Start prefetching after the frame that's already shown
+        m_prefetcher.reset(new FramePrefetcher(
+            m_frame_srcs, m_loop, frame_index(m_time + m_frame_duration)));
+    }
+    return *this;
+}
+
+LightPattern::~LightPattern()
+{
+}
+
 void LightPattern::pattern_init(const double arena_width)
 {
     m_arena_width = arena_width;
@@ -27,21 +206,21 @@ void LightPattern::pattern_init(const double arena_width,
 
 uint16_t LightPattern::get_ambientlight(const double x, const double y) const
 {
-    if (m_has_source)
+    if (m_light_map)
     {
-        // Transform from world coordinates to image coordinates
-        uint32_t x_in_img = x * m_scale;
-        uint32_t y_in_img = y * m_scale;
-
-        // Get the Color with the y-axis coordinate flip (each is 8-bit)
-        sf::Color c = m_light_pattern.getPixel(x_in_img,
-                                               m_img_dim.y - y_in_img - 1);
-        // Convert the color from RGB to grayscale using approximate luminosity
-        // Each value is 8-bit, so the resulting value is in the scale [0-255]
-        double luminosity = (0.3 * c.r) + (0.59 * c.g) + (0.11 * c.b);
-        // Scale to 10-bit [0-1023]
-        uint16_t lum_10bit = (uint16_t)luminosity * 4;
-        return lum_10bit;
+        return m_light_map->sample(m_map_level, x * m_map_scale,
+                                   y * m_map_scale) +
+               0.5;
+    }
+    else if (m_has_source)
+    {
+        // Transform from world coordinates to image coordinates, clamped so
+        // robots slightly out of bounds don't read outside the image
+        int x_in_img = x * m_scale;
+        int y_in_img = y * m_scale;
+        x_in_img = std::min(std::max(x_in_img, 0), (int)m_img_dim.x - 1);
+        y_in_img = std::min(std::max(y_in_img, 0), (int)m_img_dim.y - 1);
+        return m_frame->luminance[y_in_img * m_img_dim.x + x_in_img];
     }
     else
     {
@@ -49,9 +228,45 @@ uint16_t LightPattern::get_ambientlight(const double x, const double y) const
     }
 };
 
+void LightPattern::get_ambientlight_batch(const size_t n, const double *x,
+                                          const double *y, uint16_t *out) const
+{
+    if (m_light_map)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = get_ambientlight(x[i], y[i]);
+        }
+    }
+    else if (m_has_source)
+    {
+        const uint16_t *luminance = m_frame->luminance.data();
+        const int width = m_img_dim.x;
+        const int height = m_img_dim.y;
+        const double scale = m_scale;
+#pragma omp simd
+        for (size_t i = 0; i < n; i++)
+        {
+            int x_in_img = x[i] * scale;
+            int y_in_img = y[i] * scale;
+            x_in_img = std::min(std::max(x_in_img, 0), width - 1);
+            y_in_img = std::min(std::max(y_in_img, 0), height - 1);
+            out[i] = luminance[y_in_img * width + x_in_img];
+        }
+    }
+    else
+    {
+        std::fill(out, out + n, 0);
+    }
+}
+
 sf::Image LightPattern::get_light_pattern() const
 {
-    return m_light_pattern;
+    if (m_frame)
+    {
+        return m_frame->image;
+    }
+    return sf::Image();
 };
 
 bool LightPattern::has_source() const
@@ -59,15 +274,219 @@ bool LightPattern::has_source() const
     return m_has_source;
 }
 
+uint32_t LightPattern::get_version() const
+{
+    return m_version;
+}
+
 void LightPattern::set_light_pattern(const std::string img_src)
 {
-    if (!m_light_pattern.loadFromFile(img_src))
+    clear_dynamic();
+    set_frame(load_frame(img_src));
+};
+
+void LightPattern::set_light_sequence(const std::vector<std::string> img_srcs,
+                                      const double frame_duration,
+                                      const bool loop, const bool prefetch)
+{
+    if (img_srcs.size() == 0 || frame_duration <= 0)
+    {
+        fprintf(stderr, "ERROR: Light sequence needs at least one image and a positive frame duration\n");
+        exit(EXIT_FAILURE);
+    }
+    clear_dynamic();
+    m_frame_srcs = img_srcs;
+    m_frame_duration = frame_duration;
+    m_sequence_start = m_time;
+    m_loop = loop;
+    if (prefetch)
+    {
+        m_mode = Mode::STREAMED_SEQUENCE;
+        m_prefetcher.reset(
+            new FramePrefetcher(m_frame_srcs, m_loop, frame_index(m_time)));
+    }
+    else
+    {
+        m_mode = Mode::SEQUENCE;
+        std::shared_ptr<std::vector<std::shared_ptr<const LightFrame>>> frames =
+            std::make_shared<std::vector<std::shared_ptr<const LightFrame>>>();
+        for (auto &src : m_frame_srcs)
+        {
+            frames->push_back(load_frame(src));
+        }
+        m_frames = frames;
+    }
+    update(m_time);
+}
+
+void LightPattern::set_light_function(const lightFunc light_func,
+                                      const double arena_height,
+                                      const double resolution,
+                                      const double update_period)
+{
+    if (resolution <= 0 || update_period < 0)
+    {
+        fprintf(stderr, "ERROR: Light function needs a positive resolution and non-negative update period\n");
+        exit(EXIT_FAILURE);
+    }
+    clear_dynamic();
+    m_mode = Mode::FUNCTION;
+    m_light_func = light_func;
+    m_arena_height = arena_height;
+    m_func_resolution = resolution;
+    m_update_period = update_period;
+    update(m_time);
+}
+
+void LightPattern::set_light_map(const std::string map_file,
+                                 const uint32_t level, const bool memory_map)
+{
+    clear_dynamic();
+    std::shared_ptr<LightMap> light_map;
+    try
+    {
+        light_map.reset(new LightMap(map_file, memory_map));
+    }
+    catch (const std::runtime_error &err)
+    {
+        fprintf(stderr, "ERROR: %s\n", err.what());
+        exit(EXIT_FAILURE);
+    }
+    if (level >= light_map->get_num_levels())
     {
+        fprintf(stderr, "ERROR: Light map %s only has %d levels\n",
+                map_file.c_str(), light_map->get_num_levels());
         exit(EXIT_FAILURE);
     }
+    m_mode = Mode::MAP;
+    m_light_map = light_map;
+    m_map_level = level;
+    m_map_scale = light_map->get_width(level) / m_arena_width;
+
+    // Only a coarse level is read for display
+    uint32_t display_level = 0;
+    while (display_level + 1 < light_map->get_num_levels() &&
+           light_map->get_width(display_level) > LIGHT_MAP_IMAGE_WIDTH)
+    {
+        display_level++;
+    }
+    std::shared_ptr<LightFrame> frame = std::make_shared<LightFrame>();
+    frame->image = light_map->get_image(display_level);
+    set_frame(frame);
+}
+
+void LightPattern::update(const double t)
+{
+    const bool new_time = (t != m_time);
+    m_time = t;
+    switch (m_mode)
+    {
+    case Mode::STATIC:
+    case Mode::MAP:
+        break;
+    case Mode::SEQUENCE:
+    case Mode::STREAMED_SEQUENCE:
+    {
+        const int64_t index = frame_index(t);
+        if (index != m_frame_index)
+        {
+            m_frame_index = index;
+            if (m_mode == Mode::SEQUENCE)
+            {
+                set_frame((*m_frames)[index]);
+            }
+            else
+            {
+                set_frame(m_prefetcher->get(index));
+            }
+        }
+        break;
+    }
+    case Mode::FUNCTION:
+    {
+        int64_t step = m_func_step;
+        if (m_update_period > 0)
+        {
+            step = std::floor(t / m_update_period);
+        }
+        else if (new_time || m_func_step < 0)
+        {
+            step = m_func_step + 1;
+        }
+        if (step == m_func_step)
+        {
+            break;
+        }
+        m_func_step = step;
+
+        // Evaluate at the center of every cell
+        const uint32_t width = std::ceil(m_arena_width / m_func_resolution);
+        const uint32_t height = std::ceil(m_arena_height / m_func_resolution);
+        std::shared_ptr<LightFrame> frame = std::make_shared<LightFrame>();
+        frame->image.create(width, height);
+        frame->luminance.resize(width * height);
+        std::vector<sf::Uint8> gray(width * height);
+#pragma omp parallel for
+        for (int64_t i = 0; i < (int64_t)width * height; i++)
+        {
+            const double x = (i % width + 0.5) * m_func_resolution;
+            const double y = (i / width + 0.5) * m_func_resolution;
+            const double light = std::min(1.0, std::max(0.0, m_light_func(x, y, t)));
+            gray[i] = light * 255;
+            // Same 10-bit scale as a gray pixel in an image
+            frame->luminance[i] = (uint16_t)gray[i] * 4;
+        }
+        for (uint32_t y_in_img = 0; y_in_img < height; y_in_img++)
+        {
+            for (uint32_t x_in_img = 0; x_in_img < width; x_in_img++)
+            {
+                const sf::Uint8 g = gray[y_in_img * width + x_in_img];
+                frame->image.setPixel(x_in_img, height - y_in_img - 1,
+                                      sf::Color(g, g, g));
+            }
+        }
+        set_frame(frame);
+        // The grid may extend slightly past the World, so scale by the cell
+        // size rather than the image width
+        m_scale = 1 / m_func_resolution;
+        break;
+    }
+    }
+}
+
+void LightPattern::set_frame(const std::shared_ptr<const LightFrame> frame)
+{
+    m_frame = frame;
     // Set scaling and image dimensions when new image loaded
-    m_img_dim = m_light_pattern.getSize();
+    m_img_dim = m_frame->image.getSize();
     m_scale = (double)m_img_dim.x / m_arena_width;
     m_has_source = true;
-};
+    m_version++;
+}
+
+int64_t LightPattern::frame_index(const double t) const
+{
+    // Times before the start (e.g., from an earlier checkpoint) show the
+    // first frame
+    const int64_t index =
+        std::max(0.0, std::floor((t - m_sequence_start) / m_frame_duration));
+    const int64_t num_frames = m_frame_srcs.size();
+    if (m_loop)
+    {
+        return index % num_frames;
+    }
+    return std::min(index, num_frames - 1);
+}
+
+void LightPattern::clear_dynamic()
+{
+    m_prefetcher.reset();
+    m_frames.reset();
+    m_frame_srcs.clear();
+    m_light_func = nullptr;
+    m_light_map.reset();
+    m_frame_index = -1;
+    m_func_step = -1;
+    m_mode = Mode::STATIC;
+}
 } // namespace Kilosim
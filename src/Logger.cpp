@@ -5,11 +5,70 @@
 */
 
 #include <kilosim/Logger.h>
+#include <kilosim/Trace.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 #include <typeinfo>
 
 namespace Kilosim
 {
+//! Bit pattern of a double
+static uint64_t double_bits(const double val)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    return bits;
+}
+
+//! Whether a double is NaN or infinite, from its exponent bits (the library
+//! is built with -ffast-math, which lets std::isnan always return false)
+static bool is_non_finite(const uint64_t bits)
+{
+    const uint64_t exponent_mask = 0x7ff0000000000000ULL;
+    return (bits & exponent_mask) == exponent_mask;
+}
+
+//! Whether any value differs from the previous row by more than tolerance
+static bool row_changed(const std::vector<double> &row,
+                        const std::vector<double> &prev_row,
+                        const double tolerance)
+{
+    for (size_t i = 0; i < row.size(); i++)
+    {
+        const uint64_t bits = double_bits(row[i]);
+        const uint64_t prev_bits = double_bits(prev_row[i]);
+        if (is_non_finite(bits) || is_non_finite(prev_bits))
+        {
+            // Changing to, from, or between NaN and infinity is a change
+            if (bits != prev_bits)
+                return true;
+        }
+        else if (std::abs(row[i] - prev_row[i]) > tolerance)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//! Wrap an angle to [0, 2*pi), like Robot::wrap_angle
+static double wrap_angle(const double angle)
+{
+    const double wrapped = std::fmod(angle, 2 * PI);
+    return wrapped < 0 ? wrapped + 2 * PI : wrapped;
+}
+
+//! Round and clamp a value to an unsigned fixed-point count in [0, max_count]
+static uint32_t quantize(const double val, const uint32_t max_count)
+{
+    const long count = std::lround(val);
+    if (count < 0)
+        return 0;
+    return std::min((uint32_t)count, max_count);
+}
 
 Logger::Logger(World &world, std::string const file_id, int const trial_num,
                bool const overwrite_trials)
@@ -62,15 +121,30 @@ void Logger::set_trial(uint const trial_num)
 
     // Create a packet table dataset for the timeseries
     m_time_dset_name = m_trial_group_name + "/time";
-    FL_PacketTable *time_packet_table = new FL_PacketTable(
-        m_h5_file->getId(),
-        (char *)m_time_dset_name.c_str(),
-        H5T_NATIVE_DOUBLE, 1);
-    if (!time_packet_table->IsValid())
+    m_time_table = create_time_dset(m_time_dset_name);
+
+    // Aggregators added for a previous trial get new datasets in this trial
+    for (auto &agg : m_aggregators)
     {
-        fprintf(stderr, "WARNING: Failed to create time series");
+        agg.second.dset = create_aggregator_dset(agg.first,
+                                                 agg.second.row.size());
+        if (agg.second.time_dset)
+        {
+            agg.second.time_dset = create_time_dset(
+                m_trial_group_name + "/" + agg.first + "_time");
+        }
+        agg.second.next_tick = 0;
+        agg.second.has_last_row = false;
+    }
+    for (auto &traj : m_trajectories)
+    {
+        Trajectory &tr = traj.second;
+        tr.dset = create_trajectory_dset(traj.first, tr);
+        tr.time_dset = create_time_dset(
+            m_trial_group_name + "/" + traj.first + "_time");
+        tr.next_tick = 0;
+        std::fill(tr.prev_frame.begin(), tr.prev_frame.end(), QuantizedPose());
     }
-    m_time_table = H5PacketTablePtr(time_packet_table);
 }
 
 uint Logger::get_trial() const
@@ -79,51 +153,345 @@ uint Logger::get_trial() const
 }
 
 void Logger::add_aggregator(std::string const agg_name,
-                            aggregatorFunc const agg_func)
+                            aggregatorFunc const agg_func,
+                            const double log_period,
+                            const double change_tolerance)
 {
-    m_aggregators.insert({{agg_name, agg_func}});
-
+    check_aggregator_name(agg_name);
     // Do a test run of the aggregator to get the length of the output
     const std::vector<double> test_output = (*agg_func)(m_world.get_robots());
 
-    hsize_t out_len[1] = {test_output.size()};
-    H5::ArrayType agg_type(H5::PredType::NATIVE_DOUBLE, 1, out_len);
-    std::make_shared<H5::ArrayType>(agg_type);
+    // Wrap the function so it fills the preallocated row like any other
+    // aggregator. (The function itself still allocates its return value.)
+    add_aggregator(
+        agg_name, test_output.size(),
+        [agg_func](std::vector<Robot *> &robots, double *out,
+                   const size_t out_len) {
+            const std::vector<double> agg_val = (*agg_func)(robots);
+            if (agg_val.size() != out_len)
+            {
+                fprintf(stderr, "WARNING: Aggregator output changed length\n");
+            }
+            std::copy_n(agg_val.begin(), std::min(out_len, agg_val.size()), out);
+        },
+        log_period, change_tolerance);
+}
+
+void Logger::add_aggregator(std::string const agg_name, const size_t out_len,
+                            spanAggregatorFunc const agg_func,
+                            const double log_period,
+                            const double change_tolerance)
+{
+    check_aggregator_name(agg_name);
+    Aggregator agg;
+    agg.func = agg_func;
+    agg.row.assign(out_len, 0.0);
+    agg.dset = create_aggregator_dset(agg_name, out_len);
+    agg.period_ticks = period_to_ticks(log_period);
+    agg.next_tick = 0;
+    agg.change_tolerance = change_tolerance;
+    agg.last_row.assign(out_len, 0.0);
+    agg.has_last_row = false;
+    if (log_period > 0 || change_tolerance >= 0)
+    {
+        // These rows don't line up with the trial's shared time series
+        agg.time_dset = create_time_dset(
+            m_trial_group_name + "/" + agg_name + "_time");
+    }
+    m_aggregators[agg_name] = agg;
+}
+
+void Logger::check_aggregator_name(const std::string &agg_name) const
+{
+    // A second dataset with the same name can't be created in the trial
+    if (m_aggregators.count(agg_name) || m_trajectories.count(agg_name))
+    {
+        throw std::runtime_error("Logger already has a dataset named '" +
+                                 agg_name + "'");
+    }
+}
+
+Logger::H5PacketTablePtr Logger::create_aggregator_dset(
+    const std::string &agg_name, const size_t out_len)
+{
+    hsize_t out_len_h5[1] = {out_len};
+    H5::ArrayType agg_type(H5::PredType::NATIVE_DOUBLE, 1, out_len_h5);
 
     // Create a packet table and save it
     std::string agg_dset_name = m_trial_group_name + "/" + agg_name;
     FL_PacketTable *agg_packet_table = new FL_PacketTable(
         m_h5_file->getId(), (char *)agg_dset_name.c_str(), agg_type.getId(), 1);
-    if (!agg_packet_table)
+    if (!agg_packet_table->IsValid())
     {
         fprintf(stderr, "WARNING: Failed to create aggregator table");
     }
-    m_aggregator_dsets.insert({{agg_name, H5PacketTablePtr(agg_packet_table)}});
+    return H5PacketTablePtr(agg_packet_table);
 }
 
-void Logger::log_state() const
+uint32_t Logger::period_to_ticks(const double log_period) const
+{
+    if (log_period <= 0)
+        return 0;
+    // Convert to ticks, logging at most once per tick
+    return std::max(1L, std::lround(log_period * m_world.get_tick_rate()));
+}
+
+void Logger::add_trajectory(const std::string traj_name,
+                            const double position_resolution,
+                            const double log_period, const bool delta_encode)
+{
+    const std::vector<double> dim = m_world.get_dimensions();
+    if (position_resolution <= 0 ||
+        std::max(dim[0], dim[1]) / position_resolution > UINT16_MAX)
+    {
+        fprintf(stderr, "ERROR: Trajectory position resolution %g mm is too "
+                        "fine for the World's dimensions\n",
+                position_resolution);
+        exit(EXIT_FAILURE);
+    }
+
+    Trajectory traj;
+    traj.position_resolution = position_resolution;
+    traj.delta_encode = delta_encode;
+    traj.period_ticks = period_to_ticks(log_period);
+    traj.next_tick = 0;
+    traj.frame.assign(m_world.get_robots().size(), QuantizedPose());
+    traj.prev_frame.assign(traj.frame.size(), QuantizedPose());
+    traj.dset = create_trajectory_dset(traj_name, traj);
+    traj.time_dset = create_time_dset(
+        m_trial_group_name + "/" + traj_name + "_time");
+    m_trajectories[traj_name] = traj;
+}
+
+void Logger::add_frame_stream(const std::string filename,
+                              const double log_period)
+{
+    // Close the previous stream first, in case it's the same file
+    m_frame_stream.reset();
+    m_frame_stream.reset(new FrameStreamWriter(m_world, filename));
+    m_frame_stream_period_ticks = period_to_ticks(log_period);
+    m_frame_stream_next_tick = 0;
+}
+
+Logger::H5PacketTablePtr Logger::create_trajectory_dset(
+    const std::string &traj_name, const Trajectory &traj)
+{
+    // One Robot's pose and color
+    H5::CompType pose_type(sizeof(QuantizedPose));
+    pose_type.insertMember("x", HOFFSET(QuantizedPose, x),
+                           H5::PredType::NATIVE_UINT16);
+    pose_type.insertMember("y", HOFFSET(QuantizedPose, y),
+                           H5::PredType::NATIVE_UINT16);
+    pose_type.insertMember("theta", HOFFSET(QuantizedPose, theta),
+                           H5::PredType::NATIVE_UINT16);
+    hsize_t color_len[1] = {3};
+    H5::ArrayType color_type(H5::PredType::NATIVE_UINT8, 1, color_len);
+    pose_type.insertMember("color", HOFFSET(QuantizedPose, color), color_type);
+    // A frame (packet) is the poses of all the Robots
+    hsize_t num_robots[1] = {traj.frame.size()};
+    H5::ArrayType frame_type(pose_type, 1, num_robots);
+
+    // Delta-encoded frames are mostly small values, so they compress well
+    hid_t plist = H5P_DEFAULT;
+    hsize_t chunk_size = 1;
+    if (traj.delta_encode && H5Zfilter_avail(H5Z_FILTER_DEFLATE))
+    {
+        plist = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_shuffle(plist);
+        H5Pset_deflate(plist, 4);
+        chunk_size = 32;
+    }
+    std::string traj_dset_name = m_trial_group_name + "/" + traj_name;
+    FL_PacketTable *traj_packet_table = new FL_PacketTable(
+        m_h5_file->getId(), traj_dset_name.c_str(), frame_type.getId(),
+        chunk_size, plist);
+    if (plist != H5P_DEFAULT)
+        H5Pclose(plist);
+    if (!traj_packet_table->IsValid())
+    {
+        fprintf(stderr, "WARNING: Failed to create trajectory table");
+        return H5PacketTablePtr(traj_packet_table);
+    }
+
+    // Save everything needed to decode the frames
+    H5::DataSet dataset = m_h5_file->openDataSet(traj_dset_name);
+    H5::DataSpace scalar;
+    const double resolutions[3] = {traj.position_resolution,
+                                   2 * PI / (UINT16_MAX + 1.0),
+                                   1 / 255.0};
+    const char *resolution_names[3] = {"position_resolution",
+                                       "theta_resolution", "color_resolution"};
+    for (int i = 0; i < 3; i++)
+    {
+        dataset.createAttribute(resolution_names[i],
+                                H5::PredType::NATIVE_DOUBLE, scalar)
+            .write(H5::PredType::NATIVE_DOUBLE, &resolutions[i]);
+    }
+    const int delta_encoded = traj.delta_encode;
+    dataset.createAttribute("delta_encoded", H5::PredType::NATIVE_INT, scalar)
+        .write(H5::PredType::NATIVE_INT, &delta_encoded);
+
+    return H5PacketTablePtr(traj_packet_table);
+}
+
+void Logger::log_trajectory(Trajectory &traj)
+{
+    KILOSIM_TRACE_SCOPE("log_trajectory");
+    std::vector<Robot *> &robots = m_world.get_robots();
+    if (robots.size() != traj.frame.size())
+    {
+        fprintf(stderr, "WARNING: Number of robots changed since trajectory was added\n");
+    }
+    const size_t n = std::min(robots.size(), traj.frame.size());
+    const double pos_scale = 1 / traj.position_resolution;
+    const double theta_scale = (UINT16_MAX + 1.0) / (2 * PI);
+    for (size_t i = 0; i < n; i++)
+    {
+        const Robot &r = *robots[i];
+        QuantizedPose q = {};
+        q.x = quantize(r.x * pos_scale, UINT16_MAX);
+        q.y = quantize(r.y * pos_scale, UINT16_MAX);
+        // Angles wrap around (e.g., negative angles from robot_init), and
+        // rounding up to 2*pi is stored as 0
+        q.theta = quantize(wrap_angle(r.theta) * theta_scale, UINT16_MAX + 1) &
+                  UINT16_MAX;
+        for (int c = 0; c < 3; c++)
+        {
+            q.color[c] = quantize(r.color[c] * 255, UINT8_MAX);
+        }
+
+        if (traj.delta_encode)
+        {
+            // Unsigned differences wrap around, so a cumulative sum (in the
+            // same integer width) restores the original values
+            QuantizedPose &prev = traj.prev_frame[i];
+            QuantizedPose &d = traj.frame[i];
+            d.x = q.x - prev.x;
+            d.y = q.y - prev.y;
+            d.theta = q.theta - prev.theta;
+            for (int c = 0; c < 3; c++)
+            {
+                d.color[c] = q.color[c] - prev.color[c];
+            }
+            prev = q;
+        }
+        else
+        {
+            traj.frame[i] = q;
+        }
+    }
+
+    log_time(traj.time_dset);
+    herr_t err = traj.dset->AppendPacket(traj.frame.data());
+    if (err < 0)
+    {
+        fprintf(stderr, "WARNING: Failed to append data to trajectory table");
+    }
+}
+
+Logger::H5PacketTablePtr Logger::create_time_dset(const std::string &dset_name)
+{
+    FL_PacketTable *time_packet_table = new FL_PacketTable(
+        m_h5_file->getId(),
+        (char *)dset_name.c_str(),
+        H5T_NATIVE_DOUBLE, 1);
+    if (!time_packet_table->IsValid())
+    {
+        fprintf(stderr, "WARNING: Failed to create time series");
+    }
+    return H5PacketTablePtr(time_packet_table);
+}
+
+void Logger::log_time(const H5PacketTablePtr &time_dset) const
 {
-    // https://thispointer.com/how-to-iterate-over-an-unordered_map-in-c11/
-    // Add the current time to the time series
     double t = m_world.get_time();
-    herr_t err = m_time_table->AppendPacket(&t);
+    herr_t err = time_dset->AppendPacket(&t);
     if (err < 0)
         fprintf(stderr, "WARNING: Failed to append to time series");
+}
+
+void Logger::log_state()
+{
+    KILOSIM_TRACE_SCOPE("log_state");
+    // https://thispointer.com/how-to-iterate-over-an-unordered_map-in-c11/
+    // Add the current time to the time series
+    log_time(m_time_table);
+
+    for (auto &agg : m_aggregators)
+    {
+        if (agg.second.period_ticks == 0)
+        {
+            log_aggregator(agg.second);
+        }
+    }
+    for (auto &traj : m_trajectories)
+    {
+        if (traj.second.period_ticks == 0)
+        {
+            log_trajectory(traj.second);
+        }
+    }
+    if (m_frame_stream && m_frame_stream_period_ticks == 0)
+    {
+        m_frame_stream->log_state();
+    }
+}
 
-    for (std::pair<std::string, aggregatorFunc> agg : m_aggregators)
+void Logger::log_due()
+{
+    KILOSIM_TRACE_SCOPE("log_due");
+    const uint32_t tick = m_world.get_tick();
+    for (auto &agg : m_aggregators)
+    {
+        Aggregator &a = agg.second;
+        if (a.period_ticks > 0 && tick >= a.next_tick)
+        {
+            log_aggregator(a);
+            // Stay aligned to multiples of the period, even if calls are missed
+            a.next_tick = (tick / a.period_ticks + 1) * a.period_ticks;
+        }
+    }
+    for (auto &traj : m_trajectories)
+    {
+        Trajectory &tr = traj.second;
+        if (tr.period_ticks > 0 && tick >= tr.next_tick)
+        {
+            log_trajectory(tr);
+            tr.next_tick = (tick / tr.period_ticks + 1) * tr.period_ticks;
+        }
+    }
+    if (m_frame_stream && m_frame_stream_period_ticks > 0 &&
+        tick >= m_frame_stream_next_tick)
     {
-        // Not sure about passing the pointer / reference here ?
-        log_aggregator(agg.first, agg.second);
+        m_frame_stream->log_state();
+        m_frame_stream_next_tick =
+            (tick / m_frame_stream_period_ticks + 1) * m_frame_stream_period_ticks;
     }
 }
 
-void Logger::log_aggregator(std::string const agg_name,
-                            aggregatorFunc const agg_func) const
+void Logger::log_aggregator(Aggregator &agg)
 {
-    // Call the aggregator function on the robots
-    std::vector<double> agg_val = (*agg_func)(m_world.get_robots());
-    // TODO: append to the packet table (should be created by add_aggregator)
-    herr_t err = m_aggregator_dsets.at(agg_name)->AppendPacket(agg_val.data());
+    KILOSIM_TRACE_SCOPE("log_aggregator");
+    // Call the aggregator function on the robots, filling the reused row
+    agg.func(m_world.get_robots(), agg.row.data(), agg.row.size());
+
+    if (agg.change_tolerance >= 0)
+    {
+        // Event-driven: skip the row unless something changed enough
+        if (agg.has_last_row &&
+            !row_changed(agg.row, agg.last_row, agg.change_tolerance))
+        {
+            return;
+        }
+        std::copy(agg.row.begin(), agg.row.end(), agg.last_row.begin());
+        agg.has_last_row = true;
+    }
+
+    if (agg.time_dset)
+    {
+        log_time(agg.time_dset);
+    }
+    herr_t err = agg.dset->AppendPacket(agg.row.data());
     if (err < 0)
     {
         fprintf(stderr, "WARNING: Failed to append data to aggregator table");
@@ -132,10 +500,10 @@ void Logger::log_aggregator(std::string const agg_name,
 
 void Logger::log_config(ConfigParser &config, const bool show_warnings)
 {
-    const json j = config.get();
-    for (auto &mol : j.get<json::object_t>())
+    const json &j = config.get();
+    for (auto it = j.begin(); it != j.end(); ++it)
     {
-        log_param(mol.first, mol.second, show_warnings);
+        log_param(it.key(), it.value(), show_warnings);
     }
 }
 
@@ -0,0 +1,115 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/MappedFile.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace Kilosim
+{
+MappedFile::MappedFile(const std::string &filename, const bool writable)
+    : m_filename(filename), m_writable(writable)
+{
+    if (writable)
+    {
+        m_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    else
+    {
+        m_fd = open(filename.c_str(), O_RDONLY);
+    }
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("Failed to open " + filename + ": " +
+                                 std::strerror(errno));
+    }
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) != 0)
+    {
+        close(m_fd);
+        throw std::runtime_error("Failed to stat " + filename);
+    }
+    m_size = file_stat.st_size;
+    try
+    {
+        map();
+    }
+    catch (const std::runtime_error &)
+    {
+        // The destructor won't run if the constructor throws
+        close(m_fd);
+        throw;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+void MappedFile::resize(const size_t new_size)
+{
+    if (!m_writable)
+    {
+        throw std::runtime_error("Cannot resize read-only file " + m_filename);
+    }
+    unmap();
+    if (ftruncate(m_fd, new_size) != 0)
+    {
+        throw std::runtime_error("Failed to resize " + m_filename + ": " +
+                                 std::strerror(errno));
+    }
+    m_size = new_size;
+    map();
+}
+
+void MappedFile::flush_async()
+{
+    if (m_data)
+    {
+        msync(m_data, m_size, MS_ASYNC);
+    }
+}
+
+void MappedFile::map()
+{
+    if (m_size == 0)
+    {
+        // Empty files can't be mapped
+        m_data = nullptr;
+        return;
+    }
+    const int prot = m_writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *addr = mmap(nullptr, m_size, prot, MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        m_data = nullptr;
+        throw std::runtime_error("Failed to map " + m_filename + ": " +
+                                 std::strerror(errno));
+    }
+    m_data = (char *)addr;
+}
+
+void MappedFile::unmap()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+}
+} // namespace Kilosim
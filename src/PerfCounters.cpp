@@ -0,0 +1,136 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/PerfCounters.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace Kilosim
+{
+static const char *const PERF_COUNTER_NAMES[NUM_PERF_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"};
+
+#ifdef __linux__
+//! perf_event_open event of each PerfCounter
+static const uint64_t PERF_EVENT_CONFIGS[NUM_PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+#endif
+
+PerfCounters::PerfCounters()
+{
+    m_fds.fill(-1);
+    m_read_index.fill(-1);
+#ifdef __linux__
+    for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_EVENT_CONFIGS[c];
+        // Only count this process's own code (allowed at the default
+        // perf_event_paranoid level)
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // The leader starts disabled, so the whole group starts together
+        attr.disabled = m_leader < 0;
+        const int fd = syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0);
+        if (fd < 0)
+        {
+            // Not supported here: leave it out
+            continue;
+        }
+        if (m_leader < 0)
+        {
+            m_leader = fd;
+        }
+        m_fds[c] = fd;
+        m_read_index[c] = m_num_open++;
+    }
+    if (m_leader >= 0)
+    {
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (auto fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::is_available() const
+{
+    return m_leader >= 0;
+}
+
+bool PerfCounters::has_counter(const PerfCounter counter) const
+{
+    return m_fds[counter] >= 0;
+}
+
+bool PerfCounters::read(PerfCounts &counts) const noexcept
+{
+    counts.fill(0);
+#ifdef __linux__
+    if (m_leader < 0)
+    {
+        return false;
+    }
+    // Layout of a group read: number of counters, time enabled, time
+    // running, then each counter's value
+    uint64_t data[3 + NUM_PERF_COUNTERS];
+    const ssize_t size = (3 + m_num_open) * sizeof(uint64_t);
+    if (::read(m_leader, data, size) != size)
+    {
+        return false;
+    }
+    const uint64_t enabled = data[1];
+    const uint64_t running = data[2];
+    for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+    {
+        if (m_read_index[c] < 0)
+        {
+            continue;
+        }
+        uint64_t value = data[3 + m_read_index[c]];
+        if (running > 0 && running < enabled)
+        {
+            // Multiplexed: estimate the count over the whole time
+            value = (uint64_t)((double)value * enabled / running);
+        }
+        counts[c] = value;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *PerfCounters::get_name(const PerfCounter counter)
+{
+    return PERF_COUNTER_NAMES[counter];
+}
+} // namespace Kilosim
@@ -1,9 +1,11 @@
 #include <kilosim/Robot.h>
+#include <kilosim/Checkpoint.h>
 #include <kilosim/Random.h>
 
 #include <cmath>
 #include <iostream>
 #include <numeric>
+#include <stdexcept>
 
 namespace Kilosim
 {
@@ -106,6 +108,7 @@ void Robot::robot_move(const RobotPose &new_pose, const int16_t &collision)
 	}
 	// If a bot is touching the wall (collision_type == 2), update angle but not position
 	theta = wrap_angle(new_theta);
+	m_light_reading = -1;
 };
 
 void Robot::robot_init(double x0, double y0, double theta0)
@@ -118,6 +121,7 @@ void Robot::robot_init(double x0, double y0, double theta0)
 	x = x0;
 	y = y0;
 	theta = theta0;
+	m_light_reading = -1;
 
 	m_motor_command = 0;
 	incoming_message_flag = 0;
@@ -156,6 +160,54 @@ void Robot::add_to_world(LightPattern &light_pattern, const double dt)
 	m_tick_delta_t = dt;
 }
 
+Robot *Robot::clone() const
+{
+	throw std::runtime_error("This Robot type does not implement clone()");
+}
+
+void Robot::save_checkpoint(std::ostream &out) const
+{
+	checkpoint_write(out, id);
+	checkpoint_write(out, x);
+	checkpoint_write(out, y);
+	checkpoint_write(out, theta);
+	checkpoint_write(out, color);
+	checkpoint_write(out, incoming_message_flag);
+	checkpoint_write(out, timer);
+	checkpoint_write(out, m_collision_turn_dir);
+	checkpoint_write(out, m_collision_timer);
+	checkpoint_write(out, m_max_collision_timer);
+	checkpoint_write(out, m_motor_error);
+	checkpoint_write(out, m_motor_command);
+	checkpoint_write(out, m_forward_speed);
+	checkpoint_write(out, m_turn_speed);
+	checkpoint_write(out, battery);
+	checkpoint_write(out, tx_request);
+	save_robot_state(out);
+}
+
+void Robot::load_checkpoint(std::istream &in)
+{
+	checkpoint_read(in, id);
+	checkpoint_read(in, x);
+	checkpoint_read(in, y);
+	checkpoint_read(in, theta);
+	m_light_reading = -1;
+	checkpoint_read(in, color);
+	checkpoint_read(in, incoming_message_flag);
+	checkpoint_read(in, timer);
+	checkpoint_read(in, m_collision_turn_dir);
+	checkpoint_read(in, m_collision_timer);
+	checkpoint_read(in, m_max_collision_timer);
+	checkpoint_read(in, m_motor_error);
+	checkpoint_read(in, m_motor_command);
+	checkpoint_read(in, m_forward_speed);
+	checkpoint_read(in, m_turn_speed);
+	checkpoint_read(in, battery);
+	checkpoint_read(in, tx_request);
+	load_robot_state(in);
+}
+
 double Robot::wrap_angle(double angle) const
 {
 	// Guarantee that angle will be from 0 to 2*pi
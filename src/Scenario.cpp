@@ -0,0 +1,558 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/Scenario.h>
+#include <kilosim/MappedFile.h>
+
+#include <H5Cpp.h>
+#include <nlohmann/json.hpp>
+
+#include <limits>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace Kilosim
+{
+//! Value of parameters that a robot doesn't set
+static const double MISSING = std::numeric_limits<double>::quiet_NaN();
+//! Name of the attribute of the type dataset that holds the type names
+static const char TYPE_NAMES_ATTR[] = "type_names";
+
+size_t Scenario::size() const
+{
+    return x.size();
+}
+
+int Scenario::get_type_index(const std::string &type_name) const
+{
+    for (size_t i = 0; i < type_names.size(); i++)
+    {
+        if (type_names[i] == type_name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const std::vector<double> &Scenario::get_param(const std::string &name) const
+{
+    for (size_t i = 0; i < param_names.size(); i++)
+    {
+        if (param_names[i] == name)
+        {
+            return params[i];
+        }
+    }
+    throw std::runtime_error("Scenario has no parameter '" + name + "'");
+}
+
+bool Scenario::has_param(const std::string &name) const
+{
+    for (auto &param_name : param_names)
+    {
+        if (param_name == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scenario::init_robots(const std::vector<Robot *> &robots) const
+{
+    if (robots.size() != size())
+    {
+        throw std::runtime_error(
+            "Scenario has " + std::to_string(size()) + " robots, but " +
+            std::to_string(robots.size()) + " were given");
+    }
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        robots[i]->robot_init(x[i], y[i], theta[i]);
+    }
+}
+
+size_t Scenario::add_robot(const double new_x, const double new_y,
+                           const double new_theta, const uint16_t new_type)
+{
+    x.push_back(new_x);
+    y.push_back(new_y);
+    theta.push_back(new_theta);
+    type.push_back(new_type);
+    for (auto &values : params)
+    {
+        values.push_back(MISSING);
+    }
+    return x.size() - 1;
+}
+
+uint16_t Scenario::add_type(const std::string &type_name)
+{
+    const int index = get_type_index(type_name);
+    if (index >= 0)
+    {
+        return index;
+    }
+    if (type_names.size() > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::runtime_error("Scenario has too many types of robot");
+    }
+    type_names.push_back(type_name);
+    return type_names.size() - 1;
+}
+
+size_t Scenario::add_param(const std::string &name)
+{
+    for (size_t i = 0; i < param_names.size(); i++)
+    {
+        if (param_names[i] == name)
+        {
+            return i;
+        }
+    }
+    param_names.push_back(name);
+    params.push_back(std::vector<double>(size(), MISSING));
+    return params.size() - 1;
+}
+
+/*!
+ * SAX handler that fills a Scenario as the JSON file is parsed, ignoring
+ * everything outside of the robots array
+ */
+class ScenarioReader : public nlohmann::json_sax<json>
+{
+private:
+    //! Scenario being filled
+    Scenario &m_scenario;
+    //! Number of currently open objects/arrays
+    size_t m_depth = 0;
+    //! Depth of the robots array (0 until it's found)
+    size_t m_robots_depth = 0;
+    //! Whether the robots array is currently open
+    bool m_in_robots = false;
+    //! Whether the last top-level key was "robots"
+    bool m_robots_key = false;
+    //! Key of the current robot's value being read
+    std::string m_key;
+    //! Whether the current robot has set its x position
+    bool m_has_x;
+    //! Whether the current robot has set its y position
+    bool m_has_y;
+    //! Whether the current robot has set its type
+    bool m_has_type;
+    //! Error that stopped parsing
+    std::string m_error;
+
+public:
+    ScenarioReader(Scenario &scenario) : m_scenario(scenario) {}
+
+    //! @return Whether a robots array was found
+    bool found_robots() const { return m_robots_depth > 0; }
+    //! @return Error that stopped parsing (if any)
+    const std::string &get_error() const { return m_error; }
+
+    bool null() override { return robot_value("null"); }
+    bool boolean(bool) override { return robot_value("a bool"); }
+    bool number_integer(number_integer_t val) override
+    {
+        return robot_number(val, true);
+    }
+    bool number_unsigned(number_unsigned_t val) override
+    {
+        return robot_number(val, true);
+    }
+    bool number_float(number_float_t val, const string_t &) override
+    {
+        return robot_number(val, false);
+    }
+    bool string(string_t &val) override
+    {
+        if (!in_robot())
+        {
+            return robot_value("a string");
+        }
+        if (m_key == "type")
+        {
+            m_scenario.type.back() = m_scenario.add_type(val);
+            m_has_type = true;
+            return true;
+        }
+        return robot_value("a string");
+    }
+
+    bool start_object(std::size_t) override
+    {
+        if (in_robot())
+        {
+            return robot_value("an object");
+        }
+        m_depth++;
+        if (in_robot())
+        {
+            m_scenario.add_robot(0, 0, 0);
+            m_has_x = false;
+            m_has_y = false;
+            m_has_type = false;
+        }
+        return true;
+    }
+    bool end_object() override
+    {
+        if (in_robot())
+        {
+            const size_t n = m_scenario.size() - 1;
+            if (!m_has_x || !m_has_y)
+            {
+                return fail("Robot " + std::to_string(n) +
+                            " is missing its x or y position");
+            }
+            if (!m_has_type)
+            {
+                m_scenario.type[n] = m_scenario.add_type("0");
+            }
+        }
+        m_depth--;
+        return true;
+    }
+    bool key(string_t &val) override
+    {
+        if (in_robot())
+        {
+            m_key = val;
+        }
+        else if (m_depth == 1)
+        {
+            m_robots_key = (val == "robots");
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        if (in_robot())
+        {
+            return robot_value("an array");
+        }
+        m_depth++;
+        // The robots are either the root array or the top-level "robots" key
+        if (!found_robots() && (m_depth == 1 || (m_depth == 2 && m_robots_key)))
+        {
+            m_robots_depth = m_depth;
+            m_in_robots = true;
+        }
+        else if (in_robot())
+        {
+            return fail("Robot " + std::to_string(m_scenario.size()) +
+                        " must be an object");
+        }
+        return true;
+    }
+    bool end_array() override
+    {
+        if (m_in_robots && m_depth == m_robots_depth)
+        {
+            m_in_robots = false;
+        }
+        m_depth--;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string &,
+                     const nlohmann::detail::exception &ex) override
+    {
+        return fail(ex.what());
+    }
+
+private:
+    //! Whether values are currently fields of a robot
+    bool in_robot() const
+    {
+        return m_in_robots && m_depth == m_robots_depth + 1;
+    }
+
+    //! Handle a robot's numeric value
+    bool robot_number(const double val, const bool is_integer)
+    {
+        if (!in_robot())
+        {
+            return not_in_robots_array();
+        }
+        const size_t n = m_scenario.size() - 1;
+        if (m_key == "x")
+        {
+            m_scenario.x[n] = val;
+            m_has_x = true;
+        }
+        else if (m_key == "y")
+        {
+            m_scenario.y[n] = val;
+            m_has_y = true;
+        }
+        else if (m_key == "theta")
+        {
+            m_scenario.theta[n] = val;
+        }
+        else if (m_key == "type")
+        {
+            if (!is_integer)
+            {
+                return fail("Type of robot " + std::to_string(n) +
+                            " must be a name or an integer");
+            }
+            m_scenario.type[n] = m_scenario.add_type(std::to_string((int64_t)val));
+            m_has_type = true;
+        }
+        else
+        {
+            m_scenario.params[m_scenario.add_param(m_key)][n] = val;
+        }
+        return true;
+    }
+
+    //! Handle a robot's non-numeric value (which is only valid for its type)
+    bool robot_value(const std::string &kind)
+    {
+        if (!in_robot())
+        {
+            return not_in_robots_array();
+        }
+        return fail("Value '" + m_key + "' of robot " +
+                    std::to_string(m_scenario.size() - 1) +
+                    " must be a number, not " + kind);
+    }
+
+    //! Fail on a scalar directly in the robots array (every robot must be an
+    //! object), and ignore any other scalar outside of a robot
+    bool not_in_robots_array()
+    {
+        if (m_in_robots && m_depth == m_robots_depth)
+        {
+            return fail("Robot " + std::to_string(m_scenario.size()) +
+                        " must be an object");
+        }
+        return true;
+    }
+
+    //! Stop parsing with an error
+    bool fail(const std::string &error)
+    {
+        m_error = error;
+        return false;
+    }
+};
+
+Scenario load_scenario(const std::string filename, const std::string group)
+{
+    const size_t ext = filename.rfind('.');
+    if (ext != std::string::npos)
+    {
+        const std::string extension = filename.substr(ext);
+        if (extension == ".h5" || extension == ".hdf5")
+        {
+            return load_scenario_hdf5(filename, group);
+        }
+    }
+    return load_scenario_json(filename);
+}
+
+Scenario load_scenario_json(const std::string filename)
+{
+    MappedFile file(filename, false);
+    if (file.size() == 0)
+    {
+        throw std::runtime_error("Scenario file " + filename + " is empty");
+    }
+    Scenario scenario;
+    ScenarioReader reader(scenario);
+    if (!json::sax_parse(file.data(), file.data() + file.size(), &reader))
+    {
+        throw std::runtime_error("Invalid scenario file " + filename + ": " +
+                                 reader.get_error());
+    }
+    if (!reader.found_robots())
+    {
+        throw std::runtime_error("Scenario file " + filename +
+                                 " has no \"robots\" array");
+    }
+    return scenario;
+}
+
+//! Read a 1D dataset of n values (or any length if n is 0) as type T
+template <typename T>
+static std::vector<T> read_column(H5::Group &group, const std::string &name,
+                                  const H5::PredType &type, const size_t n,
+                                  const std::string &filename)
+{
+    H5::DataSet dataset = group.openDataSet(name);
+    H5::DataSpace space = dataset.getSpace();
+    hsize_t len = 0;
+    if (space.getSimpleExtentNdims() != 1)
+    {
+        throw std::runtime_error("Scenario dataset '" + name + "' in " +
+                                 filename + " must be 1D");
+    }
+    space.getSimpleExtentDims(&len);
+    if (n > 0 && len != n)
+    {
+        throw std::runtime_error("Scenario dataset '" + name + "' in " +
+                                 filename + " has " + std::to_string(len) +
+                                 " values, but there are " + std::to_string(n) +
+                                 " robots");
+    }
+    std::vector<T> values(len);
+    if (len > 0)
+    {
+        dataset.read(values.data(), type);
+    }
+    return values;
+}
+
+Scenario load_scenario_hdf5(const std::string filename, const std::string group_name)
+{
+    Scenario scenario;
+    try
+    {
+        H5::H5File file(filename, H5F_ACC_RDONLY);
+        H5::Group group = file.openGroup(group_name);
+        if (!group.exists("x") || !group.exists("y"))
+        {
+            throw std::runtime_error("Scenario file " + filename +
+                                     " must have 'x' and 'y' datasets");
+        }
+        scenario.x = read_column<double>(group, "x", H5::PredType::NATIVE_DOUBLE,
+                                         0, filename);
+        const size_t n = scenario.x.size();
+        scenario.y = read_column<double>(group, "y", H5::PredType::NATIVE_DOUBLE,
+                                         n, filename);
+        if (group.exists("theta"))
+        {
+            scenario.theta = read_column<double>(
+                group, "theta", H5::PredType::NATIVE_DOUBLE, n, filename);
+        }
+        else
+        {
+            scenario.theta.assign(n, 0);
+        }
+
+        if (group.exists("type"))
+        {
+            std::vector<int64_t> types = read_column<int64_t>(
+                group, "type", H5::PredType::NATIVE_INT64, n, filename);
+            H5::DataSet type_dataset = group.openDataSet("type");
+            if (type_dataset.attrExists(TYPE_NAMES_ATTR))
+            {
+                // Types are indices into the saved names
+                H5::Attribute attr = type_dataset.openAttribute(TYPE_NAMES_ATTR);
+                hsize_t num_names = 0;
+                attr.getSpace().getSimpleExtentDims(&num_names);
+                std::vector<char *> names(num_names);
+                H5::StrType str_type(H5::PredType::C_S1, H5T_VARIABLE);
+                attr.read(str_type, names.data());
+                for (auto &name : names)
+                {
+                    scenario.type_names.push_back(name);
+                }
+                H5::DataSet::vlenReclaim(names.data(), str_type, attr.getSpace());
+            }
+            scenario.type.resize(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                if (types[i] < 0)
+                {
+                    throw std::runtime_error("Robot types in " + filename +
+                                             " must be non-negative");
+                }
+                if (scenario.type_names.empty() || (size_t)types[i] >= scenario.type_names.size())
+                {
+                    scenario.type[i] = scenario.add_type(std::to_string(types[i]));
+                }
+                else
+                {
+                    scenario.type[i] = types[i];
+                }
+            }
+        }
+        else
+        {
+            scenario.type.assign(n, n > 0 ? scenario.add_type("0") : 0);
+        }
+
+        // Every other dataset is a per-robot parameter
+        for (hsize_t i = 0; i < group.getNumObjs(); i++)
+        {
+            const std::string name = group.getObjnameByIdx(i);
+            if (name == "x" || name == "y" || name == "theta" || name == "type" ||
+                group.getObjTypeByIdx(i) != H5G_DATASET)
+            {
+                continue;
+            }
+            scenario.param_names.push_back(name);
+            scenario.params.push_back(read_column<double>(
+                group, name, H5::PredType::NATIVE_DOUBLE, n, filename));
+        }
+    }
+    catch (H5::Exception &e)
+    {
+        throw std::runtime_error("Failed to read scenario file " + filename +
+                                 ": " + e.getDetailMsg());
+    }
+    return scenario;
+}
+
+//! Write a 1D dataset of values
+template <typename T>
+static H5::DataSet write_column(H5::H5File &file, const std::string &name,
+                                const H5::PredType &type,
+                                const std::vector<T> &values)
+{
+    const hsize_t len = values.size();
+    H5::DataSpace space(1, &len);
+    H5::DataSet dataset = file.createDataSet(name, type, space);
+    if (len > 0)
+    {
+        dataset.write(values.data(), type);
+    }
+    return dataset;
+}
+
+void save_scenario(const Scenario &scenario, const std::string filename)
+{
+    try
+    {
+        H5::H5File file(filename, H5F_ACC_TRUNC);
+        write_column(file, "x", H5::PredType::NATIVE_DOUBLE, scenario.x);
+        write_column(file, "y", H5::PredType::NATIVE_DOUBLE, scenario.y);
+        write_column(file, "theta", H5::PredType::NATIVE_DOUBLE, scenario.theta);
+        H5::DataSet type_dataset =
+            write_column(file, "type", H5::PredType::NATIVE_UINT16, scenario.type);
+        if (!scenario.type_names.empty())
+        {
+            const hsize_t num_names = scenario.type_names.size();
+            std::vector<const char *> names;
+            for (auto &name : scenario.type_names)
+            {
+                names.push_back(name.c_str());
+            }
+            H5::StrType str_type(H5::PredType::C_S1, H5T_VARIABLE);
+            type_dataset.createAttribute(TYPE_NAMES_ATTR, str_type,
+                                         H5::DataSpace(1, &num_names))
+                .write(str_type, names.data());
+        }
+        for (size_t i = 0; i < scenario.param_names.size(); i++)
+        {
+            write_column(file, scenario.param_names[i],
+                         H5::PredType::NATIVE_DOUBLE, scenario.params[i]);
+        }
+    }
+    catch (H5::Exception &e)
+    {
+        throw std::runtime_error("Failed to save scenario file " + filename +
+                                 ": " + e.getDetailMsg());
+    }
+}
+} // namespace Kilosim
@@ -0,0 +1,258 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/SoftwareRenderer.h>
+#include <kilosim/Trace.h>
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace Kilosim
+{
+//! Number of image rows rendered together by one thread
+static const int RENDER_BAND_ROWS = 16;
+
+SoftwareRenderer::SoftwareRenderer(World &world, const int image_width)
+    : m_world(world), m_width(image_width)
+{
+    std::vector<double> world_dim = world.get_dimensions();
+    m_scale = m_width / world_dim[0];
+    m_height = world_dim[1] * m_scale;
+
+    m_pixels.resize(3 * m_width * m_height);
+    m_band_robots.resize((m_height + RENDER_BAND_ROWS - 1) / RENDER_BAND_ROWS);
+    render_background();
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+    stop_video();
+}
+
+void SoftwareRenderer::render_background()
+{
+    m_bg_version = m_world.get_light_version();
+    m_background.assign(3 * m_width * m_height, 0);
+    if (!m_world.has_light_pattern())
+    {
+        // Same as the Viewer: blank black if there's no light pattern
+        return;
+    }
+    // Stretch the image to fill the frame (nearest neighbor, like an
+    // unsmoothed SFML texture)
+    const sf::Image img = m_world.get_light_pattern();
+    const sf::Vector2u img_size = img.getSize();
+    const sf::Uint8 *img_pixels = img.getPixelsPtr();
+    if (img_size.x == 0 || img_size.y == 0 || !img_pixels)
+    {
+        return;
+    }
+#pragma omp parallel for
+    for (int py = 0; py < m_height; py++)
+    {
+        const unsigned iy = std::min(
+            (unsigned)((py + 0.5) * img_size.y / m_height), img_size.y - 1);
+        for (int px = 0; px < m_width; px++)
+        {
+            const unsigned ix = std::min(
+                (unsigned)((px + 0.5) * img_size.x / m_width), img_size.x - 1);
+            const sf::Uint8 *src = img_pixels + 4 * (iy * img_size.x + ix);
+            uint8_t *dst = &m_background[3 * (py * m_width + px)];
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+void SoftwareRenderer::draw()
+{
+    KILOSIM_TRACE_SCOPE("software_render");
+    if (m_world.get_light_version() != m_bg_version)
+    {
+        render_background();
+    }
+
+    // Bin the robots by the bands of rows they overlap, so each band can be
+    // drawn independently (and in the same robot order as the Viewer)
+    for (auto &band : m_band_robots)
+    {
+        band.clear();
+    }
+    const std::vector<Robot *> &robots = m_world.get_robots();
+    const double r = RADIUS * m_scale;
+    for (uint32_t i = 0; i < robots.size(); i++)
+    {
+        const double cy = m_height - robots[i]->y * m_scale;
+        const int row_min = std::max(0, (int)std::floor(cy - r));
+        const int row_max = std::min(m_height - 1, (int)std::ceil(cy + r));
+        for (int b = row_min / RENDER_BAND_ROWS;
+             b <= row_max / RENDER_BAND_ROWS; b++)
+        {
+            m_band_robots[b].push_back(i);
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < (int)m_band_robots.size(); b++)
+    {
+        const int row_start = b * RENDER_BAND_ROWS;
+        const int row_end = std::min(m_height, row_start + RENDER_BAND_ROWS);
+        std::copy(m_background.begin() + 3 * row_start * m_width,
+                  m_background.begin() + 3 * row_end * m_width,
+                  m_pixels.begin() + 3 * row_start * m_width);
+        for (auto i : m_band_robots[b])
+        {
+            draw_robot(*robots[i], row_start, row_end);
+        }
+    }
+}
+
+void SoftwareRenderer::draw_robot(const Robot &robot, const int row_start,
+                                  const int row_end)
+{
+    // Matches the Viewer's robot texture: a disk in the robot's color, with a
+    // black line 2 pixels wide from the center to the edge along its heading
+    const double r = RADIUS * m_scale;
+    const double cx = robot.x * m_scale;
+    const double cy = m_height - robot.y * m_scale;
+    const double cos_t = cos(robot.theta);
+    const double sin_t = sin(robot.theta);
+    const uint8_t color[3] = {(uint8_t)(robot.color[0] * 255),
+                              (uint8_t)(robot.color[1] * 255),
+                              (uint8_t)(robot.color[2] * 255)};
+
+    const int y_min = std::max(row_start, (int)std::floor(cy - r));
+    const int y_max = std::min(row_end - 1, (int)std::ceil(cy + r));
+    const int x_min = std::max(0, (int)std::floor(cx - r));
+    const int x_max = std::min(m_width - 1, (int)std::ceil(cx + r));
+    for (int py = y_min; py <= y_max; py++)
+    {
+        // Offsets are from pixel centers, with y pointing up (as in the World)
+        const double dy = cy - (py + 0.5);
+        uint8_t *row = &m_pixels[3 * py * m_width];
+        for (int px = x_min; px <= x_max; px++)
+        {
+            const double dx = (px + 0.5) - cx;
+            if (dx * dx + dy * dy > r * r)
+            {
+                continue;
+            }
+            const double along = dx * cos_t + dy * sin_t;
+            const double across = -dx * sin_t + dy * cos_t;
+            uint8_t *dst = row + 3 * px;
+            if (along >= 0 && std::abs(across) <= 1)
+            {
+                dst[0] = dst[1] = dst[2] = 0;
+            }
+            else
+            {
+                dst[0] = color[0];
+                dst[1] = color[1];
+                dst[2] = color[2];
+            }
+        }
+    }
+}
+
+const std::vector<uint8_t> &SoftwareRenderer::get_pixels() const
+{
+    return m_pixels;
+}
+
+int SoftwareRenderer::get_width() const
+{
+    return m_width;
+}
+
+int SoftwareRenderer::get_height() const
+{
+    return m_height;
+}
+
+bool SoftwareRenderer::save_ppm(const std::string filename) const
+{
+    std::ofstream out(filename, std::ios::binary);
+    if (!out)
+    {
+        fprintf(stderr, "WARNING: Failed to open image file %s\n", filename.c_str());
+        return false;
+    }
+    out << "P6\n"
+        << m_width << " " << m_height << "\n255\n";
+    out.write((const char *)m_pixels.data(), m_pixels.size());
+    return (bool)out;
+}
+
+bool SoftwareRenderer::save_image(const std::string filename) const
+{
+    std::vector<sf::Uint8> rgba(4 * m_width * m_height);
+    for (size_t i = 0; i < (size_t)m_width * m_height; i++)
+    {
+        rgba[4 * i] = m_pixels[3 * i];
+        rgba[4 * i + 1] = m_pixels[3 * i + 1];
+        rgba[4 * i + 2] = m_pixels[3 * i + 2];
+        rgba[4 * i + 3] = 255;
+    }
+    sf::Image img;
+    img.create(m_width, m_height, rgba.data());
+    return img.saveToFile(filename);
+}
+
+bool SoftwareRenderer::start_video(const std::string filename,
+                                   const int frame_rate)
+{
+    stop_video();
+    m_video.open(filename, std::ios::binary);
+    if (!m_video)
+    {
+        fprintf(stderr, "WARNING: Failed to open video file %s\n", filename.c_str());
+        return false;
+    }
+    // Full-resolution chroma (4:4:4), so no subsampling is needed
+    m_video << "YUV4MPEG2 W" << m_width << " H" << m_height << " F"
+            << frame_rate << ":1 Ip A1:1 C444\n";
+    m_video_frame.resize(3 * m_width * m_height);
+    return true;
+}
+
+void SoftwareRenderer::add_video_frame()
+{
+    if (!m_video.is_open())
+    {
+        fprintf(stderr, "WARNING: No video started; frame not saved\n");
+        return;
+    }
+    // Convert to planar Y'CbCr (BT.601, limited range)
+    const int n = m_width * m_height;
+    uint8_t *y_plane = m_video_frame.data();
+    uint8_t *u_plane = y_plane + n;
+    uint8_t *v_plane = u_plane + n;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+        const int r = m_pixels[3 * i];
+        const int g = m_pixels[3 * i + 1];
+        const int b = m_pixels[3 * i + 2];
+        y_plane[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        u_plane[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        v_plane[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+    m_video << "FRAME\n";
+    m_video.write((const char *)m_video_frame.data(), m_video_frame.size());
+}
+
+void SoftwareRenderer::stop_video()
+{
+    if (m_video.is_open())
+    {
+        m_video.close();
+    }
+}
+} // namespace Kilosim
@@ -0,0 +1,176 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/Telemetry.h>
+
+#include <nlohmann/json.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace Kilosim
+{
+Telemetry::Telemetry(const std::string filename, const std::string socket_path,
+                     const double period, const TelemetrySample &start)
+    : m_filename(filename), m_socket_path(socket_path),
+      m_period(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(period > 0 ? period : 0))),
+      m_last(start)
+{
+    if (!m_socket_path.empty())
+    {
+        if (m_socket_path.size() >= sizeof(sockaddr_un::sun_path))
+        {
+            throw std::runtime_error("Telemetry socket path is too long: " + m_socket_path);
+        }
+        m_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (m_socket < 0)
+        {
+            throw std::runtime_error("Failed to create telemetry socket: " +
+                                     std::string(strerror(errno)));
+        }
+    }
+    m_next_due = start.wall_time + m_period;
+    m_thread = std::thread(&Telemetry::run, this);
+}
+
+Telemetry::~Telemetry()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+    }
+}
+
+void Telemetry::publish(TelemetrySample &sample) noexcept
+{
+    m_next_due = sample.wall_time + m_period;
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        // The thread is taking the previous snapshot: skip this one
+        return;
+    }
+    // Replaces a snapshot that hasn't been written yet
+    std::swap(m_pending, sample);
+    m_has_pending = true;
+    lock.unlock();
+    m_cv.notify_all();
+}
+
+void Telemetry::publish_blocking(TelemetrySample &sample)
+{
+    m_next_due = sample.wall_time + m_period;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(m_pending, sample);
+        m_has_pending = true;
+    }
+    m_cv.notify_all();
+}
+
+void Telemetry::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_cv.wait(lock, [&] { return m_stop || m_has_pending; });
+        if (!m_has_pending)
+        {
+            return;
+        }
+        const TelemetrySample sample = std::move(m_pending);
+        m_has_pending = false;
+        lock.unlock();
+        // Format and write without holding the lock
+        write(sample);
+        lock.lock();
+    }
+}
+
+void Telemetry::write(const TelemetrySample &sample)
+{
+    const double interval =
+        std::chrono::duration<double>(sample.wall_time - m_last.wall_time).count();
+    // The tick can go back (e.g., loading an earlier checkpoint)
+    const uint32_t ticks = sample.tick > m_last.tick ? sample.tick - m_last.tick : 0;
+
+    json snapshot;
+    snapshot["pid"] = getpid();
+    snapshot["tick"] = sample.tick;
+    snapshot["time"] = sample.time;
+    snapshot["ticks_per_sec"] = interval > 0 ? ticks / interval : 0;
+    snapshot["num_robots"] = sample.num_robots;
+    snapshot["messages_delivered"] = sample.messages_delivered;
+    snapshot["robot_collisions"] = sample.robot_collisions;
+    snapshot["wall_collisions"] = sample.wall_collisions;
+    json phases = json::object();
+    for (size_t p = 0; p < sample.phase_times.size(); p++)
+    {
+        const double total = sample.phase_times[p].second;
+        // Mean over the ticks since the previous snapshot
+        double ms_per_tick = 0;
+        if (ticks > 0 && p < m_last.phase_times.size())
+        {
+            // A total that went down was reset (World::reset_times), so
+            // it's all from since the previous snapshot
+            const double prev_total = m_last.phase_times[p].second;
+            ms_per_tick = (total - (total >= prev_total ? prev_total : 0)) * 1e3 / ticks;
+        }
+        phases[sample.phase_times[p].first] = {{"total", total},
+                                               {"ms_per_tick", ms_per_tick}};
+    }
+    snapshot["phases"] = phases;
+    const std::string text = snapshot.dump() + "\n";
+    m_last = sample;
+
+    if (!m_filename.empty())
+    {
+        // Write a temporary file and rename it over the old one, so readers
+        // never see a partial snapshot
+        const std::string tmp_filename = m_filename + ".tmp";
+        FILE *out = fopen(tmp_filename.c_str(), "w");
+        bool failed = !out;
+        if (out)
+        {
+            failed = fwrite(text.data(), 1, text.size(), out) != text.size();
+            failed = fclose(out) != 0 || failed;
+        }
+        failed = failed || std::rename(tmp_filename.c_str(), m_filename.c_str()) != 0;
+        if (failed && !m_file_failed)
+        {
+            fprintf(stderr, "WARNING: Failed to write telemetry file %s\n",
+                    m_filename.c_str());
+        }
+        m_file_failed = failed;
+    }
+
+    if (m_socket >= 0)
+    {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, m_socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        // Fails (harmlessly) if no one is listening
+        sendto(m_socket, text.data(), text.size(), MSG_DONTWAIT,
+               (const sockaddr *)&addr, sizeof(addr));
+    }
+}
+} // namespace Kilosim
@@ -0,0 +1,182 @@
+/*
+    Kilosim
+
+    Created 2026-10
+*/
+
+#include <kilosim/Trace.h>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Kilosim
+{
+//! One recorded event
+struct TraceEvent
+{
+    const char *name;
+    //! Begin and end, in ns since the trace epoch
+    int64_t begin;
+    int64_t end;
+};
+
+//! Ring buffer of the events recorded on one thread
+struct TraceBuffer
+{
+    //! Guards the events (only contended while the trace is being written)
+    std::mutex mutex;
+    //! Events, overwritten oldest first once full
+    std::vector<TraceEvent> events;
+    //! Total number of events recorded (the next one goes at next % size)
+    uint64_t next = 0;
+    //! Thread id in the trace
+    uint32_t tid;
+    //! Name of the thread in the trace
+    std::string name;
+};
+
+//! Guards the list of buffers and the capacity
+static std::mutex trace_mutex;
+//! Buffers of every thread that has recorded an event (kept after the
+//! thread exits, so its events can still be written)
+static std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+//! Number of events each new buffer holds
+static size_t trace_capacity = 1 << 16;
+//! Time that event times are relative to
+static const std::chrono::steady_clock::time_point trace_epoch =
+    std::chrono::steady_clock::now();
+//! Buffer of the calling thread (null until it records an event)
+static thread_local TraceBuffer *thread_buffer = nullptr;
+
+//! Get the calling thread's buffer, creating it if needed
+static TraceBuffer *get_thread_buffer()
+{
+    if (!thread_buffer)
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+        buffer->events.resize(trace_capacity);
+        buffer->tid = trace_buffers.size() + 1;
+        buffer->name = "thread " + std::to_string(buffer->tid);
+        thread_buffer = buffer.get();
+        trace_buffers.push_back(std::move(buffer));
+    }
+    return thread_buffer;
+}
+
+//! Nanoseconds since the trace epoch
+static int64_t trace_time(const std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - trace_epoch).count();
+}
+
+void record_trace_event(const char *name,
+                        const std::chrono::steady_clock::time_point begin,
+                        const std::chrono::steady_clock::time_point end) noexcept
+{
+    TraceBuffer *buffer;
+    try
+    {
+        buffer = get_thread_buffer();
+    }
+    catch (...)
+    {
+        // Out of memory for a new buffer: drop the event
+        return;
+    }
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    // The capacity is a power of 2
+    TraceEvent &event = buffer->events[buffer->next & (buffer->events.size() - 1)];
+    event.name = name;
+    event.begin = trace_time(begin);
+    event.end = trace_time(end);
+    buffer->next++;
+}
+
+void set_trace_capacity(const size_t events_per_thread)
+{
+    size_t capacity = 1;
+    while (capacity < events_per_thread)
+    {
+        capacity *= 2;
+    }
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    trace_capacity = capacity;
+}
+
+void set_trace_thread_name(const std::string name)
+{
+    TraceBuffer *buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->name = name;
+}
+
+//! Write a string as a JSON string (names are code literals, so only quotes
+//! and backslashes need escaping)
+static void write_json_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const char *c = str; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', out);
+        }
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+void write_trace(const std::string filename)
+{
+    FILE *out = fopen(filename.c_str(), "w");
+    if (!out)
+    {
+        throw std::runtime_error("Failed to open trace file " + filename);
+    }
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    for (auto &buffer : trace_buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",", buffer->tid);
+        write_json_string(out, buffer->name.c_str());
+        fprintf(out, "}}");
+        first = false;
+
+        // Oldest to newest
+        const uint64_t size = buffer->events.size();
+        const uint64_t start = buffer->next > size ? buffer->next - size : 0;
+        for (uint64_t i = start; i < buffer->next; i++)
+        {
+            const TraceEvent &event = buffer->events[i & (size - 1)];
+            fprintf(out, ",\n{\"name\":");
+            write_json_string(out, event.name);
+            // Chrome traces are in microseconds
+            fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->tid, event.begin * 1e-3, (event.end - event.begin) * 1e-3);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    const bool failed = ferror(out);
+    if (fclose(out) != 0 || failed)
+    {
+        throw std::runtime_error("Failed to write trace file " + filename);
+    }
+}
+
+void clear_trace()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    for (auto &buffer : trace_buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->next = 0;
+    }
+}
+} // namespace Kilosim
@@ -8,31 +8,73 @@
 */
 
 #include <kilosim/Viewer.h>
+#include <kilosim/Trace.h>
+
+#include <algorithm>
 
 namespace Kilosim
 {
-Viewer::Viewer(World &world, const int window_width)
-    : m_world(world), m_window_width(window_width)
+//! How far the view can be zoomed in (relative to the whole World)
+static const float MAX_ZOOM = 64;
+//! Zoom factor for each step of the mouse wheel or +/- keys
+static const float ZOOM_STEP = 1.25;
+//! Fraction of the view panned by each press of an arrow key
+static const float PAN_STEP = 0.1;
+//! Below this radius (pixels) robots are shown as a density heatmap
+static const float DENSITY_MIN_ROBOT_PIXELS = 2;
+//! Maximum number of grid cells along the longer side of the World
+static const int MAX_GRID_CELLS = 256;
+
+Viewer::Viewer(World &world, const int window_width, const bool render_thread)
+    : m_world(world), m_window_width(window_width),
+      m_robot_vertices(sf::Quads), m_threaded(render_thread),
+      m_running(true), m_window_open(true), m_snapshot_requested(true)
 {
     std::vector<double> world_dim = world.get_dimensions();
     m_scale = m_window_width / world_dim[0];
     m_window_height = world_dim[1] * m_scale;
+    m_view.reset(sf::FloatRect(0, 0, m_window_width, m_window_height));
 
-    // m_settings.antialiasingLevel = 32;
-    m_window.create(sf::VideoMode(m_window_width, m_window_height),
-                    "Kilosim", sf::Style::Default, m_settings);
-    m_window.setFramerateLimit(144);
+    // Grid cells are at least one robot wide, but coarse enough that the
+    // density heatmap stays small
+    m_cell_size = std::max(2.0 * RADIUS,
+                           std::max(world_dim[0], world_dim[1]) / MAX_GRID_CELLS);
+    m_grid_width = std::ceil(world_dim[0] / m_cell_size);
+    m_grid_height = std::ceil(world_dim[1] / m_cell_size);
+    m_cell_start.resize(m_grid_width * m_grid_height + 1);
 
-    m_background.setSize(sf::Vector2f(m_window_width, m_window_height));
-    if (world.has_light_pattern())
+    if (m_threaded)
     {
-        m_bg_texture.loadFromImage(world.get_light_pattern());
+        // The window must be created (and its events handled) on the thread
+        // that draws in it
+        m_render_thread = std::thread(&Viewer::render_loop, this);
     }
     else
     {
-        // If world doesn't have a light source texture, use blank black
-        m_bg_texture.create(m_window_width, m_window_height);
+        init_window();
     }
+}
+
+Viewer::~Viewer()
+{
+    m_running = false;
+    if (m_render_thread.joinable())
+    {
+        m_render_thread.join();
+    }
+}
+
+void Viewer::init_window()
+{
+    // m_settings.antialiasingLevel = 32;
+    m_window.create(sf::VideoMode(m_window_width, m_window_height),
+                    "Kilosim", sf::Style::Default, m_settings);
+    m_window.setFramerateLimit(144);
+
+    // Blank black until a snapshot has a light pattern (the World's light
+    // pattern is only read when taking snapshots)
+    m_background.setSize(sf::Vector2f(m_window_width, m_window_height));
+    m_bg_texture.create(m_window_width, m_window_height);
     m_background.setTexture(&m_bg_texture);
 
     // Create the texture for the Kilobot robots once
@@ -45,60 +87,385 @@ Viewer::Viewer(World &world, const int window_width)
     line.setFillColor(sf::Color::Black);
     line.setPosition(RADIUS * m_scale, RADIUS * m_scale - 1);
     m_robot_texture.draw(line);
+    m_robot_texture.display();
+
+    // Heatmap covers the whole grid (which may extend past the World)
+    m_density_image.create(m_grid_width, m_grid_height, sf::Color::Transparent);
+    m_density_texture.loadFromImage(m_density_image);
+    m_density_texture.setSmooth(true);
+    m_density_shape.setSize(sf::Vector2f(m_grid_width * m_cell_size * m_scale,
+                                         m_grid_height * m_cell_size * m_scale));
+    m_density_shape.setPosition(
+        0, m_window_height - m_grid_height * m_cell_size * m_scale);
+    m_density_shape.setTexture(&m_density_texture);
 }
 
 void Viewer::draw()
 {
-    if (m_window.isOpen())
+    KILOSIM_TRACE_SCOPE("viewer_draw");
+    if (!m_threaded)
+    {
+        if (!m_window.isOpen())
+        {
+            return;
+        }
+        take_snapshot(m_snapshot);
+        m_grid_dirty = true;
+        m_density_dirty = true;
+        render();
+        return;
+    }
+
+    // Never wait on the render thread: if it's still drawing the last
+    // snapshot (or is taking it right now), drop this frame
+    if (!m_window_open || !m_snapshot_requested)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_snapshot_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+    take_snapshot(m_published);
+    m_snapshot_ready = true;
+    m_snapshot_requested = false;
+}
+
+void Viewer::render_loop()
+{
+#ifdef KILOSIM_TRACE
+    set_trace_thread_name("viewer");
+#endif
+    init_window();
+    while (m_running && m_window.isOpen())
     {
-        sf::Event event;
-        while (m_window.pollEvent(event))
         {
-            if (event.type == sf::Event::Closed)
+            std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+            if (m_snapshot_ready)
             {
-                m_window.close();
+                std::swap(m_snapshot, m_published);
+                m_grid_dirty = true;
+                m_density_dirty = true;
+                m_snapshot_ready = false;
+                m_snapshot_requested = true;
             }
         }
+        // Redraw even without a new snapshot, to keep the window responsive.
+        // This is paced by the window's frame rate limit.
+        render();
+    }
+    m_window_open = false;
+    m_window.close();
+}
+
+void Viewer::take_snapshot(Snapshot &snapshot) const
+{
+    const std::vector<Robot *> &robots = m_world.get_robots();
+    snapshot.time = m_world.get_time();
+    // The light pattern rarely changes, so only copy it when it does
+    if (snapshot.light_version != m_world.get_light_version())
+    {
+        snapshot.light_version = m_world.get_light_version();
+        snapshot.light_image = m_world.get_light_pattern();
+    }
+    snapshot.robots.resize(robots.size());
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        const Robot *r = robots[i];
+        RobotSnapshot &rs = snapshot.robots[i];
+        rs.x = r->x;
+        rs.y = r->y;
+        rs.theta = r->theta;
+        rs.color = sf::Color(r->color[0] * 255,
+                             r->color[1] * 255,
+                             r->color[2] * 255);
+    }
+}
+
+void Viewer::render()
+{
+    KILOSIM_TRACE_SCOPE("viewer_render");
+    sf::Event event;
+    while (m_window.pollEvent(event))
+    {
+        handle_event(event);
+    }
+    if (!m_window.isOpen())
+    {
+        return;
+    }
+
+    if (m_snapshot.light_version != m_bg_version)
+    {
+        m_bg_texture.loadFromImage(m_snapshot.light_image);
+        m_background.setTexture(&m_bg_texture, true);
+        m_bg_version = m_snapshot.light_version;
     }
 
     m_window.clear();
+    m_window.setView(m_view);
 
     // Draw world's lightPattern
     m_window.draw(m_background);
-    draw_time();
+    draw_time(m_snapshot.time);
 
-    // TODO: Implement this
-    for (auto &r : m_world.get_robots())
+    if (m_grid_dirty)
+    {
+        build_grid();
+    }
+    const float robot_pixels =
+        RADIUS * m_scale * m_window_width / m_view.getSize().x;
+    if (robot_pixels < DENSITY_MIN_ROBOT_PIXELS)
+    {
+        draw_density();
+    }
+    else
     {
-        draw_robot(r);
-        // r->draw();
+        draw_visible_robots();
     }
 
     m_window.display();
 }
 
-void Viewer::draw_robot(Robot *r)
+void Viewer::handle_event(const sf::Event &event)
 {
-    // TODO : Implement this
-    // Maybe move this to Robot.h (each robot responsible for determining its
-    // own representation)
+    switch (event.type)
+    {
+    case sf::Event::Closed:
+        m_window.close();
+        break;
+    case sf::Event::MouseWheelScrolled:
+        if (event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel)
+        {
+            zoom_view(event.mouseWheelScroll.delta > 0 ? 1 / ZOOM_STEP : ZOOM_STEP,
+                      sf::Vector2i(event.mouseWheelScroll.x,
+                                   event.mouseWheelScroll.y));
+        }
+        break;
+    case sf::Event::MouseButtonPressed:
+        if (event.mouseButton.button == sf::Mouse::Left)
+        {
+            m_dragging = true;
+            m_drag_pos = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+        }
+        break;
+    case sf::Event::MouseButtonReleased:
+        if (event.mouseButton.button == sf::Mouse::Left)
+        {
+            m_dragging = false;
+        }
+        break;
+    case sf::Event::MouseMoved:
+        if (m_dragging)
+        {
+            // Move the view so the World follows the mouse
+            const float view_per_pixel = m_view.getSize().x / m_window_width;
+            m_view.move((m_drag_pos.x - event.mouseMove.x) * view_per_pixel,
+                        (m_drag_pos.y - event.mouseMove.y) * view_per_pixel);
+            m_drag_pos = sf::Vector2i(event.mouseMove.x, event.mouseMove.y);
+            clamp_view();
+        }
+        break;
+    case sf::Event::KeyPressed:
+    {
+        const sf::Vector2f size = m_view.getSize();
+        const sf::Vector2i center(m_window_width / 2, m_window_height / 2);
+        switch (event.key.code)
+        {
+        case sf::Keyboard::Left:
+            m_view.move(-size.x * PAN_STEP, 0);
+            break;
+        case sf::Keyboard::Right:
+            m_view.move(size.x * PAN_STEP, 0);
+            break;
+        case sf::Keyboard::Up:
+            m_view.move(0, -size.y * PAN_STEP);
+            break;
+        case sf::Keyboard::Down:
+            m_view.move(0, size.y * PAN_STEP);
+            break;
+        case sf::Keyboard::Add:
+        case sf::Keyboard::Equal:
+            zoom_view(1 / ZOOM_STEP, center);
+            break;
+        case sf::Keyboard::Subtract:
+        case sf::Keyboard::Hyphen:
+            zoom_view(ZOOM_STEP, center);
+            break;
+        case sf::Keyboard::Home:
+            m_view.reset(sf::FloatRect(0, 0, m_window_width, m_window_height));
+            break;
+        default:
+            break;
+        }
+        clamp_view();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Viewer::zoom_view(const float factor, const sf::Vector2i pixel)
+{
+    // Position under the pixel (in unzoomed window coordinates)
+    const sf::Vector2f size = m_view.getSize();
+    const sf::Vector2f center = m_view.getCenter();
+    const sf::Vector2f fixed(
+        center.x + (pixel.x / (float)m_window_width - 0.5f) * size.x,
+        center.y + (pixel.y / (float)m_window_height - 0.5f) * size.y);
+
+    const float max_width = m_window_width;
+    const float min_width = m_window_width / MAX_ZOOM;
+    const float new_width =
+        std::min(max_width, std::max(min_width, size.x * factor));
+    const float f = new_width / size.x;
+    m_view.setSize(size.x * f, size.y * f);
+    m_view.setCenter(fixed.x + (center.x - fixed.x) * f,
+                     fixed.y + (center.y - fixed.y) * f);
+    clamp_view();
+}
+
+void Viewer::clamp_view()
+{
+    // Keep the center of the view within the World
+    const sf::Vector2f center = m_view.getCenter();
+    m_view.setCenter(std::min((float)m_window_width, std::max(0.0f, center.x)),
+                     std::min((float)m_window_height, std::max(0.0f, center.y)));
+}
+
+void Viewer::build_grid()
+{
+    // Counting sort of the robots by cell
+    const int num_cells = m_grid_width * m_grid_height;
+    const std::vector<RobotSnapshot> &robots = m_snapshot.robots;
+    std::fill(m_cell_start.begin(), m_cell_start.end(), 0);
+    std::vector<uint32_t> robot_cells(robots.size());
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        const int cx = std::min(m_grid_width - 1,
+                                std::max(0, (int)(robots[i].x / m_cell_size)));
+        const int cy = std::min(m_grid_height - 1,
+                                std::max(0, (int)(robots[i].y / m_cell_size)));
+        robot_cells[i] = cy * m_grid_width + cx;
+        m_cell_start[robot_cells[i] + 1]++;
+    }
+    for (int c = 0; c < num_cells; c++)
+    {
+        m_cell_start[c + 1] += m_cell_start[c];
+    }
+    m_cell_robots.resize(robots.size());
+    std::vector<uint32_t> next(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        m_cell_robots[next[robot_cells[i]]++] = i;
+    }
+    m_grid_dirty = false;
+}
+
+void Viewer::draw_visible_robots()
+{
+    // Visible region in World coordinates, padded so robots partially in
+    // view are still drawn
+    const sf::Vector2f size = m_view.getSize();
+    const sf::Vector2f center = m_view.getCenter();
+    const double x_min = (center.x - size.x / 2) / m_scale - RADIUS;
+    const double x_max = (center.x + size.x / 2) / m_scale + RADIUS;
+    const double y_min = (m_window_height - (center.y + size.y / 2)) / m_scale - RADIUS;
+    const double y_max = (m_window_height - (center.y - size.y / 2)) / m_scale + RADIUS;
+    const int cx_min = std::max(0, (int)std::floor(x_min / m_cell_size));
+    const int cx_max = std::min(m_grid_width - 1, (int)(x_max / m_cell_size));
+    const int cy_min = std::max(0, (int)std::floor(y_min / m_cell_size));
+    const int cy_max = std::min(m_grid_height - 1, (int)(y_max / m_cell_size));
+
+    size_t num_visible = 0;
+    for (int cy = cy_min; cy <= cy_max; cy++)
+    {
+        num_visible += m_cell_start[cy * m_grid_width + cx_max + 1] -
+                       m_cell_start[cy * m_grid_width + cx_min];
+    }
+
+    // Draw all of the visible robots as textured quads in a single draw call
+    m_robot_vertices.resize(4 * num_visible);
+    size_t v = 0;
+    for (int cy = cy_min; cy <= cy_max; cy++)
+    {
+        // Cells in a row of the grid are contiguous in m_cell_robots
+        const uint32_t start = m_cell_start[cy * m_grid_width + cx_min];
+        const uint32_t end = m_cell_start[cy * m_grid_width + cx_max + 1];
+        for (uint32_t j = start; j < end; j++)
+        {
+            draw_robot(m_snapshot.robots[m_cell_robots[j]], &m_robot_vertices[v]);
+            v += 4;
+        }
+    }
+    m_window.draw(m_robot_vertices, &m_robot_texture.getTexture());
+}
 
-    sf::Sprite sprite;
-    sprite.setOrigin(RADIUS * m_scale, RADIUS * m_scale);
-    sprite.setTexture(m_robot_texture.getTexture());
-    sprite.setColor(sf::Color(r->color[0] * 255,
-                              r->color[1] * 255,
-                              r->color[2] * 255));
-    sprite.setPosition(sf::Vector2f(r->x * m_scale,
-                                    m_window_height - (r->y * m_scale)));
-    sprite.setRotation(r->theta * -180 / PI);
+void Viewer::draw_density()
+{
+    if (m_density_dirty)
+    {
+        uint32_t max_count = 1;
+        for (int c = 0; c < m_grid_width * m_grid_height; c++)
+        {
+            max_count = std::max(max_count, m_cell_start[c + 1] - m_cell_start[c]);
+        }
+        for (int cy = 0; cy < m_grid_height; cy++)
+        {
+            for (int cx = 0; cx < m_grid_width; cx++)
+            {
+                const int c = cy * m_grid_width + cx;
+                const uint32_t count = m_cell_start[c + 1] - m_cell_start[c];
+                sf::Color color = sf::Color::Transparent;
+                if (count > 0)
+                {
+                    // Black-red-yellow-white heat scale, relative to the
+                    // densest cell
+                    const float d = 3.0f * count / max_count;
+                    color = sf::Color(255 * std::min(1.0f, d),
+                                      255 * std::min(1.0f, std::max(0.0f, d - 1)),
+                                      255 * std::min(1.0f, std::max(0.0f, d - 2)),
+                                      224);
+                }
+                // Image rows go down, but grid rows go up (like the World)
+                m_density_image.setPixel(cx, m_grid_height - 1 - cy, color);
+            }
+        }
+        m_density_texture.update(m_density_image);
+        m_density_dirty = false;
+    }
+    m_window.draw(m_density_shape);
+}
 
-    m_window.draw(sprite);
+void Viewer::draw_robot(const RobotSnapshot &r, sf::Vertex *quad)
+{
+    // Same as drawing the robot texture as a sprite with its origin at the
+    // center of the robot, rotated by -theta (SFML rotates clockwise)
+    const float tex_size = m_robot_texture.getTexture().getSize().x;
+    const float origin = RADIUS * m_scale;
+    const float cx = r.x * m_scale;
+    const float cy = m_window_height - (r.y * m_scale);
+    const float cos_t = cos(r.theta);
+    const float sin_t = sin(r.theta);
+
+    const float corners[4][2] = {
+        {0, 0}, {tex_size, 0}, {tex_size, tex_size}, {0, tex_size}};
+    for (int i = 0; i < 4; i++)
+    {
+        const float lx = corners[i][0] - origin;
+        const float ly = corners[i][1] - origin;
+        quad[i].position = sf::Vector2f(cx + lx * cos_t + ly * sin_t,
+                                        cy - lx * sin_t + ly * cos_t);
+        quad[i].texCoords = sf::Vector2f(corners[i][0], corners[i][1]);
+        quad[i].color = r.color;
+    }
 }
 
-void Viewer::draw_time()
+void Viewer::draw_time(const double time)
 {
-    int t = m_world.get_time();
+    int t = time;
     int hour = t / 3600;
     t = t % 3600;
     int minute = t / 60;
@@ -1,16 +1,43 @@
 #include <kilosim/World.h>
+#include <kilosim/Checkpoint.h>
 #include <kilosim/Random.h>
+#include <kilosim/Trace.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
 #include <stdexcept>
 
 // Implementation of Kilobot Arena/World
 
 namespace Kilosim
 {
+//! Names of the phases of a step (in the order of World::Phase)
+static const char *const PHASE_NAMES[] = {
+    "step_memory", "controllers", "communicate", "compute_next_step",
+    "collisions", "move", "step"};
+
+//! Identifies a World checkpoint file (the first 8 bytes of the file)
+static const char CHECKPOINT_MAGIC[8] = {'K', 'S', 'I', 'M', 'C', 'K', 'P', 'T'};
+//! Version of the checkpoint layout
+static const uint32_t CHECKPOINT_VERSION = 2;
+
 World::World(const double arena_width, const double arena_height,
              const std::string light_pattern_src, const uint32_t num_threads)
+    : World(arena_width, arena_height, light_pattern_src, num_threads, 0,
+            arena_width)
+{
+}
+
+World::World(const double arena_width, const double arena_height,
+             const std::string light_pattern_src, const uint32_t num_threads,
+             const double collision_x0, const double collision_width)
     : m_arena_width(arena_width), m_arena_height(arena_height),
-      cb(arena_width, arena_height, 2 * RADIUS)
+      cb(collision_width, arena_height, 2 * RADIUS, collision_x0)
 {
     if (light_pattern_src.size() > 0)
     {
@@ -37,6 +64,60 @@ World::World(const double arena_width, const double arena_height,
 #endif
 }
 
+World::World(const World &other)
+    : m_tick(other.m_tick),
+      m_arena_width(other.m_arena_width),
+      m_arena_height(other.m_arena_height),
+      m_light_pattern(other.m_light_pattern),
+      cb(other.cb)
+{
+    // Totals continue from the original, like the tick
+    m_messages_delivered = other.m_messages_delivered;
+    m_robot_collisions = other.m_robot_collisions;
+    m_wall_collisions = other.m_wall_collisions;
+    if (other.m_num_tiles > 0)
+    {
+        enable_tiling(other.m_num_tiles, other.m_tile_border,
+                      other.m_tile_rebalance_period);
+    }
+    for (auto &r : other.m_robots)
+    {
+        Robot *copy = r->clone();
+        m_owned_robots.emplace_back(copy);
+        // Points the copy at this World's light pattern
+        add_robot(copy);
+    }
+}
+
+std::unique_ptr<World> World::clone() const
+{
+    std::unique_ptr<World> copy(new World(*this));
+    std::ostringstream rand_out;
+    save_rand_state(rand_out);
+    copy->m_rand_snapshot = rand_out.str();
+    std::ostringstream thread_rand_out;
+    save_thread_rand_state(thread_rand_out);
+    copy->m_thread_rand_snapshot = thread_rand_out.str();
+    return copy;
+}
+
+void World::restore_rand_state() const
+{
+    if (m_rand_snapshot.size() == 0)
+        return;
+    if (omp_in_parallel())
+    {
+        // Other threads may be using (or restoring) their own generators
+        std::istringstream rand_in(m_thread_rand_snapshot);
+        load_thread_rand_state(rand_in);
+    }
+    else
+    {
+        std::istringstream rand_in(m_rand_snapshot);
+        load_rand_state(rand_in);
+    }
+}
+
 World::~World()
 {
     // TODO: Implement World destructor (any destructors, zB)
@@ -44,44 +125,119 @@ World::~World()
 
 void World::step()
 {
-    timer_step.start();
+    const phase_clock::time_point step_start = start_step();
 
-    timer_step_memory.start();
+    phase_clock::time_point phase_start = phase_clock::now();
     // Initialize vectors that are used in parallelism
     std::vector<RobotPose> new_poses((m_robots.size()));
     std::vector<int16_t> collisions(m_robots.size(), 0);
-    timer_step_memory.stop();
+    // Tiles can't be stepped in parallel inside another parallel region, and
+    // their nested threads would all share one random number generator
+    const bool tiled = m_num_tiles > 0 && !omp_in_parallel();
+    if (tiled)
+        update_tiles();
+    end_phase(PHASE_STEP_MEMORY, phase_start);
 
     // Apply robot controller for all robots
-    timer_controllers.start();
-    run_controllers();
-    timer_controllers.stop();
+    update_light_readings(tiled);
+    if (tiled)
+        run_controllers_tiled();
+    else
+        run_controllers();
+    end_phase(PHASE_CONTROLLERS, phase_start);
 
     // Communication between all robot pairs
-    timer_communicate.start();
-    communicate();
-    timer_communicate.stop();
+    if (tiled)
+        communicate_tiled();
+    else
+        communicate();
+    end_phase(PHASE_COMMUNICATE, phase_start);
 
     // Compute potential movement for all robots
-    timer_compute_next_step.start();
-    compute_next_step(new_poses);
-    timer_compute_next_step.stop();
+    if (tiled)
+        compute_next_step_tiled(new_poses);
+    else
+        compute_next_step(new_poses);
+    end_phase(PHASE_COMPUTE_NEXT_STEP, phase_start);
 
     // Check for collisions between all robot pairs
-    timer_collisions.start();
-    find_collisions(new_poses, collisions);
-    timer_collisions.stop();
+    if (tiled)
+        find_collisions_tiled(new_poses, collisions);
+    else
+        find_collisions(new_poses, collisions);
+    end_phase(PHASE_COLLISIONS, phase_start);
 
     // And execute move if no collision
     // or turn if collision
-    timer_move.start();
-    move_robots(new_poses, collisions);
-    timer_move.stop();
+    if (tiled)
+        move_robots_tiled(new_poses, collisions);
+    else
+        move_robots(new_poses, collisions);
+    end_phase(PHASE_MOVE, phase_start);
+
+    end_step(step_start);
+}
 
+World::phase_clock::time_point World::start_step()
+{
+    const phase_clock::time_point step_start = phase_clock::now();
+    if (!m_perf.empty())
+    {
+        read_perf_counters(m_step_start_counts);
+    }
+
+    // Bring a time-varying light pattern up to date before robots sense it
+    m_light_pattern.update(get_time());
+
+    if (!m_perf.empty())
+    {
+        read_perf_counters(m_phase_start_counts);
+    }
+    return step_start;
+}
+
+void World::end_step(const phase_clock::time_point step_start)
+{
     // Increment time
     m_tick++;
 
-    timer_step.stop();
+    phase_clock::time_point now = step_start;
+    end_phase(PHASE_STEP, now);
+
+    // Just a clock comparison unless a snapshot is due
+    if (m_telemetry && m_telemetry->is_due(now))
+    {
+        TelemetrySample sample = get_telemetry_sample();
+        m_telemetry->publish(sample);
+    }
+}
+
+void World::end_phase(const Phase phase, phase_clock::time_point &start) noexcept
+{
+    const phase_clock::time_point now = phase_clock::now();
+    m_phase_times[phase].record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+    KILOSIM_TRACE_EVENT(PHASE_NAMES[phase], start, now);
+    start = now;
+
+    if (!m_perf.empty())
+    {
+        PerfCounts counts;
+        if (read_perf_counters(counts))
+        {
+            const PerfCounts &from =
+                phase == PHASE_STEP ? m_step_start_counts : m_phase_start_counts;
+            for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+            {
+                // Scaled (multiplexed) counts can go backwards slightly
+                if (counts[c] > from[c])
+                {
+                    m_phase_counts[phase][c] += counts[c] - from[c];
+                }
+            }
+            m_phase_start_counts = counts;
+        }
+    }
 }
 
 sf::Image World::get_light_pattern() const
@@ -99,18 +255,100 @@ void World::set_light_pattern(std::string light_pattern_src)
     m_light_pattern.set_light_pattern(light_pattern_src);
 }
 
+void World::set_light_sequence(const std::vector<std::string> light_img_srcs,
+                               const double frame_duration, const bool loop,
+                               const bool prefetch)
+{
+    m_light_pattern.update(get_time());
+    m_light_pattern.set_light_sequence(light_img_srcs, frame_duration, loop,
+                                       prefetch);
+}
+
+void World::set_light_function(const lightFunc light_func,
+                               const double resolution,
+                               const double update_period)
+{
+    m_light_pattern.update(get_time());
+    m_light_pattern.set_light_function(light_func, m_arena_height, resolution,
+                                       update_period);
+}
+
+void World::set_light_map(const std::string map_file, const uint32_t level,
+                          const bool memory_map)
+{
+    m_light_pattern.set_light_map(map_file, level, memory_map);
+}
+
+uint32_t World::get_light_version() const
+{
+    return m_light_pattern.get_version();
+}
+
 void World::add_robot(Robot *robot)
 {
-    robot->add_to_world(m_light_pattern, m_tick_delta_t);
+    attach_robot(robot);
     m_robots.push_back(robot);
 }
 
+void World::attach_robot(Robot *robot)
+{
+    robot->add_to_world(m_light_pattern, m_tick_delta_t);
+}
+
 void World::remove_robot(Robot *robot)
 {
     // TODO: Implement this
     printf("This does nothing right now");
 }
 
+void World::update_light_readings(const bool parallel)
+{
+    if (!m_light_pattern.has_source())
+    {
+        // Sensors read 0 without a light pattern, which is cheap anyway
+        return;
+    }
+    const size_t n = m_robots.size();
+    m_sensor_x.resize(n);
+    m_sensor_y.resize(n);
+    m_sensor_theta.resize(n);
+    m_light_readings.resize(n);
+    // Blocks are big enough to amortize scheduling, small enough to balance
+    const size_t block_size = 256;
+    const long num_blocks = (n + block_size - 1) / block_size;
+#pragma omp parallel for schedule(dynamic, 1) if (parallel)
+    for (long b = 0; b < num_blocks; b++)
+    {
+        const size_t begin = b * block_size;
+        const size_t end = std::min(begin + block_size, n);
+        double *sensor_x = m_sensor_x.data();
+        double *sensor_y = m_sensor_y.data();
+        double *sensor_theta = m_sensor_theta.data();
+        for (size_t i = begin; i < end; i++)
+        {
+            sensor_x[i] = m_robots[i]->x;
+            sensor_y[i] = m_robots[i]->y;
+            sensor_theta[i] = m_robots[i]->theta;
+        }
+        // Equivalent to Robot::light_sensor_position (truncated to whole mm)
+        // up to rounding: the vectorized cos/sin can differ from the scalar
+        // ones in the last bit, which may move a sensor across a mm boundary
+#pragma omp simd
+        for (size_t i = begin; i < end; i++)
+        {
+            sensor_x[i] = (int)(sensor_x[i] + RADIUS * std::cos(sensor_theta[i]));
+            sensor_y[i] = (int)(sensor_y[i] + RADIUS * std::sin(sensor_theta[i]));
+        }
+        m_light_pattern.get_ambientlight_batch(end - begin, sensor_x + begin,
+                                               sensor_y + begin,
+                                               m_light_readings.data() + begin);
+        for (size_t i = begin; i < end; i++)
+        {
+            m_robots[i]->set_light_reading(m_light_readings[i]);
+        }
+    }
+}
+
 void World::run_controllers()
 {
     // #pragma omp parallel for default(none) //schedule(static)
@@ -129,6 +367,7 @@ void World::communicate()
 
     if (m_tick % m_comm_rate == 0)
     {
+        uint64_t delivered = 0;
         // #pragma omp parallel for
         for (unsigned int tx_i = 0; tx_i < m_robots.size(); tx_i++)
         {
@@ -155,11 +394,13 @@ void World::communicate()
                             rx_r.receive_msg(msg, dist);
                             // Tell the sender that the message sent successfully
                             tx_r.received();
+                            delivered++;
                         }
                     }
                 }
             }
         }
+        m_messages_delivered += delivered;
     }
 }
 
@@ -195,6 +436,8 @@ void World::find_collisions(const std::vector<RobotPose> &new_poses, std::vector
     //to ensure that wall collisions are still adequately accounted for. It also
     //reduces the potential for parallelism since it introduces a data race.
 
+    uint64_t wall_collisions = 0;
+    uint64_t robot_collisions = 0;
     // #pragma omp parallel for schedule(static)
     for (unsigned int ci = 0; ci < m_robots.size(); ci++)
     {
@@ -208,6 +451,7 @@ void World::find_collisions(const std::vector<RobotPose> &new_poses, std::vector
             // There's a collision with the wall.
             // Don't even bother to check for collisions with other robots
             collisions[ci] = -1;
+            wall_collisions++;
             continue;
         }
 
@@ -224,6 +468,7 @@ void World::find_collisions(const std::vector<RobotPose> &new_poses, std::vector
             if (distance < 4 * RADIUS * RADIUS)
             {
                 collisions[ci] = 1;
+                robot_collisions++;
                 // Don't need to worry about more than 1 collision
                 return false; //I'm done looking at neighbours
             }
@@ -233,6 +478,8 @@ void World::find_collisions(const std::vector<RobotPose> &new_poses, std::vector
 
         cb.considerNeighbours(cr.x, cr.y, func);
     }
+    m_wall_collisions += wall_collisions;
+    m_robot_collisions += robot_collisions;
 
 #ifdef CHECKSANE
     for (unsigned int ci = 0; ci < m_robots.size(); ci++)
@@ -269,6 +516,283 @@ void World::move_robots(std::vector<RobotPose> &new_poses,
     }
 }
 
+void World::update_tiles()
+{
+    const size_t n = m_robots.size();
+    bool rebalance = m_tick - m_tiles_balanced_tick >= m_tile_rebalance_period ||
+                     m_tile_edges.size() != m_num_tiles + 1;
+    if (m_sorted.size() != n)
+    {
+        // Robots were added: sort from scratch
+        m_sorted.resize(n);
+        std::iota(m_sorted.begin(), m_sorted.end(), 0);
+        std::sort(m_sorted.begin(), m_sorted.end(),
+                  [&](const uint32_t a, const uint32_t b) {
+                      return m_robots[a]->x < m_robots[b]->x;
+                  });
+        m_sorted_x.resize(n);
+        for (size_t k = 0; k < n; k++)
+        {
+            m_sorted_x[k] = m_robots[m_sorted[k]]->x;
+        }
+        rebalance = true;
+    }
+    else
+    {
+        // Robots barely move in a tick, so the previous order is nearly
+        // sorted and an insertion sort is close to linear
+        for (size_t k = 0; k < n; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            const double x = m_robots[i]->x;
+            size_t j = k;
+            while (j > 0 && m_sorted_x[j - 1] > x)
+            {
+                m_sorted[j] = m_sorted[j - 1];
+                m_sorted_x[j] = m_sorted_x[j - 1];
+                j--;
+            }
+            m_sorted[j] = i;
+            m_sorted_x[j] = x;
+        }
+    }
+    if (rebalance)
+    {
+        rebalance_tiles();
+    }
+
+    // Robots in each tile (and its border), from the tile edges
+    const auto first_at = [&](const double x) -> size_t {
+        return std::lower_bound(m_sorted_x.begin(), m_sorted_x.end(), x) -
+               m_sorted_x.begin();
+    };
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        TileRange &range = m_tile_ranges[t];
+        // The outer tiles also hold any robots beyond the walls
+        range.begin = t == 0 ? 0 : first_at(m_tile_edges[t]);
+        range.end = t == m_num_tiles - 1 ? n : first_at(m_tile_edges[t + 1]);
+        range.border_begin =
+            t == 0 ? 0 : first_at(m_tile_edges[t] - m_tile_border);
+        range.border_end = t == m_num_tiles - 1
+                               ? n
+                               : first_at(m_tile_edges[t + 1] + m_tile_border);
+    }
+}
+
+void World::rebalance_tiles()
+{
+    const size_t n = m_robots.size();
+    m_tiles_balanced_tick = m_tick;
+    m_tile_edges.resize(m_num_tiles + 1);
+    m_tile_edges[0] = 0;
+    m_tile_edges[m_num_tiles] = m_arena_width;
+    for (uint32_t t = 1; t < m_num_tiles; t++)
+    {
+        // Quantiles of the robots' x-positions
+        m_tile_edges[t] = n > 0 ? m_sorted_x[t * n / m_num_tiles]
+                                : m_arena_width * t / m_num_tiles;
+    }
+
+    // Collision detection covers each tile and its border, plus a bin of
+    // padding for robots that move out of it
+    const double margin = m_tile_border + 2 * RADIUS;
+    m_tile_boxes.clear();
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const double x0 = m_tile_edges[t] - margin;
+        const double width = m_tile_edges[t + 1] - m_tile_edges[t] + 2 * margin;
+        m_tile_boxes.emplace_back(width, m_arena_height, 2 * RADIUS, x0);
+    }
+}
+
+void World::run_controllers_tiled()
+{
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            if (uniform_rand_real(0, 1) < m_prob_control_execute)
+            {
+                m_robots[m_sorted[k]]->robot_controller();
+            }
+        }
+    }
+}
+
+void World::communicate_tiled()
+{
+    if (m_tick % m_comm_rate != 0)
+    {
+        return;
+    }
+    const size_t n = m_robots.size();
+    m_messages.resize(n);
+    m_acks.assign(n, 0);
+
+    // Get every message first, since each is sent to robots in many tiles
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            m_messages[i] = m_robots[i]->get_message();
+        }
+    }
+
+    uint64_t delivered = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : delivered)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        // Senders in the tile and its border, by y-position, so each receiver
+        // only checks the senders within the border's distance of it
+        std::vector<std::pair<double, uint32_t>> &senders = m_tile_senders[t];
+        senders.clear();
+        for (size_t k = range.border_begin; k < range.border_end; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            if (m_messages[i])
+            {
+                senders.emplace_back(m_robots[i]->y, i);
+            }
+        }
+        std::sort(senders.begin(), senders.end());
+
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t rx_i = m_sorted[k];
+            Robot &rx_r = *m_robots[rx_i];
+            auto s = std::lower_bound(
+                senders.begin(), senders.end(),
+                std::make_pair(rx_r.y - m_tile_border, (uint32_t)0));
+            for (; s != senders.end() && s->first <= rx_r.y + m_tile_border; s++)
+            {
+                const uint32_t tx_i = s->second;
+                Robot &tx_r = *m_robots[tx_i];
+                if (tx_i == rx_i || std::abs(tx_r.x - rx_r.x) > m_tile_border)
+                {
+                    continue;
+                }
+                double dist = tx_r.distance(tx_r.x, tx_r.y, rx_r.x, rx_r.y);
+                if (tx_r.comm_criteria(dist) && rx_r.comm_criteria(dist))
+                {
+                    rx_r.receive_msg(m_messages[tx_i], dist);
+                    // The sender may be in another tile, so it's told after
+                    // every tile is done
+#pragma omp atomic
+                    m_acks[tx_i]++;
+                    delivered++;
+                }
+            }
+        }
+    }
+    m_messages_delivered += delivered;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            for (uint32_t a = 0; a < m_acks[i]; a++)
+            {
+                m_robots[i]->received();
+            }
+        }
+    }
+}
+
+void World::compute_next_step_tiled(std::vector<RobotPose> &new_poses)
+{
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            new_poses[i] = m_robots[i]->robot_compute_next_step();
+        }
+    }
+}
+
+void World::find_collisions_tiled(const std::vector<RobotPose> &new_poses,
+                                  std::vector<int16_t> &collisions)
+{
+    uint64_t wall_collisions = 0;
+    uint64_t robot_collisions = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : wall_collisions, robot_collisions)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        // Positions of the tile's robots and its border's, so the tile's
+        // robots are at [range.begin - range.border_begin, ...)
+        std::vector<RobotPose> &poses = m_tile_poses[t];
+        poses.clear();
+        for (size_t k = range.border_begin; k < range.border_end; k++)
+        {
+            poses.push_back(new_poses[m_sorted[k]]);
+        }
+        CollisionBoxes &boxes = m_tile_boxes[t];
+        boxes.update(poses);
+
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t ci = m_sorted[k];
+            const unsigned int local_ci = k - range.border_begin;
+            const auto &cr = poses[local_ci];
+            if (cr.x <= RADIUS ||
+                cr.x >= m_arena_width - RADIUS ||
+                cr.y <= RADIUS ||
+                cr.y >= m_arena_height - RADIUS)
+            {
+                collisions[ci] = -1;
+                wall_collisions++;
+                continue;
+            }
+
+            const auto func = [&](const unsigned int ni) -> bool {
+                if (local_ci == ni)
+                    return true;
+                const auto &nr = poses[ni];
+                const double distance = pow(cr.x - nr.x, 2) + pow(cr.y - nr.y, 2);
+                if (distance < 4 * RADIUS * RADIUS)
+                {
+                    collisions[ci] = 1;
+                    robot_collisions++;
+                    return false;
+                }
+                return true;
+            };
+
+            boxes.considerNeighbours(cr.x, cr.y, func);
+        }
+    }
+    m_wall_collisions += wall_collisions;
+    m_robot_collisions += robot_collisions;
+}
+
+void World::move_robots_tiled(std::vector<RobotPose> &new_poses,
+                              const std::vector<int16_t> &collisions)
+{
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint32_t t = 0; t < m_num_tiles; t++)
+    {
+        const TileRange &range = m_tile_ranges[t];
+        for (size_t k = range.begin; k < range.end; k++)
+        {
+            const uint32_t i = m_sorted[k];
+            m_robots[i]->robot_move(new_poses[i], collisions[i]);
+        }
+    }
+}
+
 uint16_t World::get_tick_rate() const
 {
     return m_tick_rate;
@@ -289,6 +813,21 @@ std::vector<Robot *> &World::get_robots()
     return m_robots;
 }
 
+uint64_t World::get_messages_delivered() const
+{
+    return m_messages_delivered;
+}
+
+uint64_t World::get_robot_collisions() const
+{
+    return m_robot_collisions;
+}
+
+uint64_t World::get_wall_collisions() const
+{
+    return m_wall_collisions;
+}
+
 std::vector<double> World::get_dimensions() const
 {
     std::vector<double> dimensions{m_arena_width, m_arena_height};
@@ -297,13 +836,209 @@ std::vector<double> World::get_dimensions() const
 
 void World::printTimes() const
 {
-    std::cerr << "t timer_step              = " << timer_step.accumulated() << std::endl;
-    std::cerr << "t timer_step_memory       = " << timer_step_memory.accumulated() << std::endl;
-    std::cerr << "t timer_controllers       = " << timer_controllers.accumulated() << std::endl;
-    std::cerr << "t timer_communicate       = " << timer_communicate.accumulated() << std::endl;
-    std::cerr << "t timer_compute_next_step = " << timer_compute_next_step.accumulated() << std::endl;
-    std::cerr << "t timer_collisions        = " << timer_collisions.accumulated() << std::endl;
-    std::cerr << "t timer_move              = " << timer_move.accumulated() << std::endl;
+    std::cerr << "t phase              total(s)   mean(ms)    p50(ms)    p95(ms)    p99(ms)    max(ms)"
+              << std::endl;
+    for (auto &stats : get_phase_stats())
+    {
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "t %-17s %9.4f %10.4f %10.4f %10.4f %10.4f %10.4f",
+                 stats.name.c_str(), stats.total, stats.mean * 1e3,
+                 stats.p50 * 1e3, stats.p95 * 1e3, stats.p99 * 1e3,
+                 stats.max * 1e3);
+        std::cerr << line << std::endl;
+    }
+
+    if (m_perf.empty())
+    {
+        return;
+    }
+    if (!m_perf[0]->is_available())
+    {
+        std::cerr << "t (hardware counters unavailable)" << std::endl;
+        return;
+    }
+    std::cerr << "t phase                  cycles   instructions    IPC   cache_misses  branch_misses"
+              << std::endl;
+    for (auto &stats : get_phase_stats())
+    {
+        const PerfCounts &c = stats.counters;
+        const double ipc = c[PERF_CYCLES] > 0
+                               ? (double)c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]
+                               : 0;
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "t %-17s %13llu %14llu %6.2f %14llu %14llu",
+                 stats.name.c_str(), (unsigned long long)c[PERF_CYCLES],
+                 (unsigned long long)c[PERF_INSTRUCTIONS], ipc,
+                 (unsigned long long)c[PERF_CACHE_MISSES],
+                 (unsigned long long)c[PERF_BRANCH_MISSES]);
+        std::cerr << line << std::endl;
+    }
+}
+
+std::vector<PhaseStats> World::get_phase_stats() const
+{
+    std::vector<PhaseStats> all_stats;
+    for (int p = 0; p < NUM_PHASES; p++)
+    {
+        const LatencyHistogram &hist = m_phase_times[p];
+        PhaseStats stats;
+        stats.name = PHASE_NAMES[p];
+        stats.count = hist.get_count();
+        stats.total = hist.get_total();
+        stats.mean = hist.get_mean();
+        stats.p50 = hist.get_percentile(50);
+        stats.p95 = hist.get_percentile(95);
+        stats.p99 = hist.get_percentile(99);
+        stats.max = hist.get_max();
+        stats.counters = m_phase_counts[p];
+        all_stats.push_back(stats);
+    }
+    return all_stats;
+}
+
+std::vector<std::pair<std::string, double>> World::get_phase_times() const
+{
+    std::vector<std::pair<std::string, double>> times;
+    for (int p = 0; p < NUM_PHASES; p++)
+    {
+        times.push_back({PHASE_NAMES[p], m_phase_times[p].get_total()});
+    }
+    return times;
+}
+
+void World::reset_times()
+{
+    for (auto &hist : m_phase_times)
+    {
+        hist.reset();
+    }
+    for (auto &counts : m_phase_counts)
+    {
+        counts.fill(0);
+    }
+}
+
+bool World::enable_perf_counters()
+{
+    // Counters only count the thread that opens them, so open a set on every
+    // OpenMP thread. OpenMP reuses its threads between parallel regions, so
+    // these keep counting the threads that later step tiles.
+    m_perf.clear();
+    const int num_threads = omp_get_max_threads();
+    m_perf.resize(num_threads);
+#pragma omp parallel num_threads(num_threads)
+    {
+        m_perf[omp_get_thread_num()].reset(new PerfCounters());
+    }
+    // Thread 0 is the calling thread
+    if (!m_perf[0])
+    {
+        m_perf[0].reset(new PerfCounters());
+    }
+    if (!m_perf[0]->is_available())
+    {
+        fprintf(stderr, "WARNING: Hardware performance counters are unavailable; only timing steps\n");
+        return false;
+    }
+    return true;
+}
+
+void World::disable_perf_counters()
+{
+    m_perf.clear();
+}
+
+bool World::read_perf_counters(PerfCounts &counts) const noexcept
+{
+    counts.fill(0);
+    bool any_read = false;
+    for (auto &perf : m_perf)
+    {
+        PerfCounts thread_counts;
+        if (perf && perf->read(thread_counts))
+        {
+            for (int c = 0; c < NUM_PERF_COUNTERS; c++)
+            {
+                counts[c] += thread_counts[c];
+            }
+            any_read = true;
+        }
+    }
+    return any_read;
+}
+
+void World::enable_telemetry(const std::string filename,
+                             const std::string socket_path,
+                             const double period)
+{
+    // Stop any previous publisher first, so it doesn't race on the file
+    m_telemetry.reset();
+    m_telemetry.reset(new Telemetry(filename, socket_path, period,
+                                    get_telemetry_sample()));
+}
+
+void World::disable_telemetry()
+{
+    if (m_telemetry)
+    {
+        TelemetrySample sample = get_telemetry_sample();
+        // Never dropped, unlike the periodic snapshots
+        m_telemetry->publish_blocking(sample);
+        // Waits for the final snapshot to be written
+        m_telemetry.reset();
+    }
+}
+
+TelemetrySample World::get_telemetry_sample() const
+{
+    TelemetrySample sample;
+    sample.wall_time = std::chrono::steady_clock::now();
+    sample.tick = m_tick;
+    sample.time = get_time();
+    sample.num_robots = m_robots.size();
+    sample.messages_delivered = m_messages_delivered;
+    sample.robot_collisions = m_robot_collisions;
+    sample.wall_collisions = m_wall_collisions;
+    sample.phase_times = get_phase_times();
+    return sample;
+}
+
+void World::enable_tiling(const uint32_t num_tiles, const double border,
+                          const uint32_t rebalance_period)
+{
+    if (border < 2 * RADIUS)
+    {
+        // Otherwise a robot near a tile edge could miss a neighbor that sees it
+        throw std::invalid_argument(
+            "Tile border must be at least the collision diameter (" +
+            std::to_string(2 * RADIUS) + " mm)");
+    }
+#ifdef _OPENMP
+    m_num_tiles = num_tiles > 0 ? num_tiles : omp_get_max_threads();
+#else
+    m_num_tiles = num_tiles > 0 ? num_tiles : 1;
+#endif
+    m_tile_border = border;
+    m_tile_rebalance_period = std::max(rebalance_period, 1u);
+    m_tile_ranges.resize(m_num_tiles);
+    m_tile_poses.resize(m_num_tiles);
+    m_tile_senders.resize(m_num_tiles);
+    // Sorted and balanced on the next step
+    m_sorted.clear();
+}
+
+void World::disable_tiling()
+{
+    m_num_tiles = 0;
+    m_sorted.clear();
+    m_sorted_x.clear();
+    m_tile_edges.clear();
+    m_tile_ranges.clear();
+    m_tile_boxes.clear();
+    m_tile_poses.clear();
+    m_tile_senders.clear();
 }
 
 void World::check_validity() const
@@ -324,4 +1059,119 @@ void World::check_validity() const
     std::cerr << "World is valid." << std::endl;
 }
 
-} // namespace Kilosim
\ No newline at end of file
+void World::save_checkpoint(const std::string filename) const
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Failed to open checkpoint file " + filename);
+
+    out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    checkpoint_write(out, CHECKPOINT_VERSION);
+    checkpoint_write(out, m_arena_width);
+    checkpoint_write(out, m_arena_height);
+    checkpoint_write(out, m_tick);
+    checkpoint_write(out, m_messages_delivered);
+    checkpoint_write(out, m_robot_collisions);
+    checkpoint_write(out, m_wall_collisions);
+    checkpoint_write(out, (uint64_t)m_robots.size());
+
+    // Each Robot is saved with its size so mismatched Robots are detected
+    for (auto &r : m_robots)
+    {
+        std::ostringstream robot_out;
+        r->save_checkpoint(robot_out);
+        checkpoint_write(out, robot_out.str());
+    }
+
+    std::ostringstream rand_out;
+    save_rand_state(rand_out);
+    checkpoint_write(out, rand_out.str());
+
+    if (!out)
+        throw std::runtime_error("Failed to write checkpoint file " + filename);
+}
+
+void World::load_checkpoint(const std::string filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Failed to open checkpoint file " + filename);
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint32_t version;
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+        throw std::runtime_error(filename + " is not a Kilosim checkpoint");
+    checkpoint_read(in, version);
+    if (version != CHECKPOINT_VERSION)
+        throw std::runtime_error(filename + " has an unsupported checkpoint version");
+
+    double arena_width, arena_height;
+    uint32_t tick;
+    uint64_t messages_delivered, robot_collisions, wall_collisions;
+    uint64_t num_robots;
+    checkpoint_read(in, arena_width);
+    checkpoint_read(in, arena_height);
+    checkpoint_read(in, tick);
+    checkpoint_read(in, messages_delivered);
+    checkpoint_read(in, robot_collisions);
+    checkpoint_read(in, wall_collisions);
+    checkpoint_read(in, num_robots);
+    if (arena_width != m_arena_width || arena_height != m_arena_height)
+        throw std::runtime_error("Checkpoint arena dimensions don't match the World");
+    if (num_robots != m_robots.size())
+        throw std::runtime_error("Checkpoint has " + std::to_string(num_robots) +
+                                 " robots, but the World has " +
+                                 std::to_string(m_robots.size()));
+
+    // Read the whole file before changing anything, so a truncated file
+    // leaves the World as it was
+    std::vector<std::string> robot_states(num_robots);
+    for (auto &robot_state : robot_states)
+        checkpoint_read(in, robot_state);
+    std::string rand_state;
+    checkpoint_read(in, rand_state);
+
+    // Robots can still reject their saved state (if they don't match), so
+    // keep the current state to roll back to
+    std::vector<std::string> old_robot_states;
+    for (auto &r : m_robots)
+    {
+        std::ostringstream robot_out;
+        r->save_checkpoint(robot_out);
+        old_robot_states.push_back(robot_out.str());
+    }
+    std::ostringstream old_rand_out;
+    save_rand_state(old_rand_out);
+    try
+    {
+        for (size_t i = 0; i < m_robots.size(); i++)
+        {
+            std::istringstream robot_in(robot_states[i]);
+            m_robots[i]->load_checkpoint(robot_in);
+            // Anything left over means the Robot doesn't match the saved one
+            if (robot_in.peek() != std::char_traits<char>::eof())
+                throw std::runtime_error("Checkpoint robot state doesn't match the World's robots");
+        }
+        std::istringstream rand_in(rand_state);
+        load_rand_state(rand_in);
+    }
+    catch (const std::runtime_error &)
+    {
+        for (size_t i = 0; i < m_robots.size(); i++)
+        {
+            std::istringstream robot_in(old_robot_states[i]);
+            m_robots[i]->load_checkpoint(robot_in);
+        }
+        std::istringstream old_rand_in(old_rand_out.str());
+        load_rand_state(old_rand_in);
+        throw;
+    }
+
+    m_tick = tick;
+    m_messages_delivered = messages_delivered;
+    m_robot_collisions = robot_collisions;
+    m_wall_collisions = wall_collisions;
+}
+
+} // namespace Kilosim
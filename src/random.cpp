@@ -7,11 +7,18 @@
 #include <iostream>
 #include <functional>
 #include <limits>
+#include <stdexcept>
+
+//Engines and distributions for every thread. (Distributions can have state
+//too, e.g. normal_distribution generates values in pairs.)
+static our_random_engine engines[PRNG_THREAD_MAX];
+static std::uniform_int_distribution<> int_dists[PRNG_THREAD_MAX];
+static std::uniform_real_distribution<> real_dists[PRNG_THREAD_MAX];
+static std::normal_distribution<double> normal_dists[PRNG_THREAD_MAX];
 
 our_random_engine &rand_engine()
 {
-  static our_random_engine e[PRNG_THREAD_MAX];
-  return e[omp_get_thread_num()];
+  return engines[omp_get_thread_num()];
 }
 
 //Be sure to read: http://www.pcg-random.org/posts/cpp-seeding-surprises.html
@@ -36,21 +43,55 @@ void seed_rand(unsigned long seed)
 
 int uniform_rand_int(int from, int thru)
 {
-  static std::uniform_int_distribution<> d[PRNG_THREAD_MAX];
   using parm_t = std::uniform_int_distribution<>::param_type;
-  return d[omp_get_thread_num()](rand_engine(), parm_t{from, thru});
+  return int_dists[omp_get_thread_num()](rand_engine(), parm_t{from, thru});
 }
 
 double uniform_rand_real(double from, double thru)
 {
-  static std::uniform_real_distribution<> d[PRNG_THREAD_MAX];
   using parm_t = std::uniform_real_distribution<>::param_type;
-  return d[omp_get_thread_num()](rand_engine(), parm_t{from, thru});
+  return real_dists[omp_get_thread_num()](rand_engine(), parm_t{from, thru});
 }
 
 double normal_rand(double mean, double stddev)
 {
-  static std::normal_distribution<double> d[PRNG_THREAD_MAX];
   using parm_t = std::normal_distribution<double>::param_type;
-  return d[omp_get_thread_num()](rand_engine(), parm_t{mean, stddev});
+  return normal_dists[omp_get_thread_num()](rand_engine(), parm_t{mean, stddev});
+}
+
+//The standard library's text format for engines and distributions is exact
+//(including full-precision doubles), so it is used for the saved state
+static void save_one_rand_state(std::ostream &out, const int t)
+{
+  out << engines[t] << ' ' << int_dists[t] << ' ' << real_dists[t] << ' '
+      << normal_dists[t] << ' ';
+}
+
+static void load_one_rand_state(std::istream &in, const int t)
+{
+  in >> engines[t] >> int_dists[t] >> real_dists[t] >> normal_dists[t];
+  if (!in)
+    throw std::runtime_error("Failed to read random number generator state");
+}
+
+void save_rand_state(std::ostream &out)
+{
+  for (int t = 0; t < PRNG_THREAD_MAX; t++)
+    save_one_rand_state(out, t);
+}
+
+void load_rand_state(std::istream &in)
+{
+  for (int t = 0; t < PRNG_THREAD_MAX; t++)
+    load_one_rand_state(in, t);
+}
+
+void save_thread_rand_state(std::ostream &out)
+{
+  save_one_rand_state(out, omp_get_thread_num());
+}
+
+void load_thread_rand_state(std::istream &in)
+{
+  load_one_rand_state(in, omp_get_thread_num());
 }
\ No newline at end of file